@@ -714,10 +714,23 @@ LRESULT Display_win::handle(HWND hwnd, UINT msg, WPARAM wp, LPARAM lp) {
                 Rect inval = from_winrect(ps.rcPaint);
                 pr_->set_obscured_area(inval);
                 Painter pr(wii->wrap_painter(pr_));
+                Paint_profiler * prof = wii->paint_profiler();
+                pr_->set_profiler(prof);
+                if (prof) { prof->begin_frame(); }
+                pr_->profile_enter(wii, true);
                 wii->handle_backpaint(pr, inval);
+                pr_->profile_leave();
+                pr_->profile_enter(wii, false);
                 wii->handle_paint(pr, inval);
+                pr_->profile_leave();
                 pr_->end_paint();
                 pr_->wreset();
+
+                if (prof) {
+                    pr_->set_profiler(nullptr);
+                    prof->end_frame(0);
+                    prof->dump_env(wii);
+                }
                 return TRUE;
             }
 
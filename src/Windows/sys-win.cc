@@ -315,6 +315,41 @@ void msleep(unsigned time_ms) {
     Sleep(time_ms);
 }
 
+File_map::File_map(const ustring & path) {
+    HANDLE fh = CreateFileW(str_to_wstring(path).c_str(), GENERIC_READ, FILE_SHARE_READ|FILE_SHARE_WRITE, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (INVALID_HANDLE_VALUE == fh) { throw sys_error(path); }
+    LARGE_INTEGER sz;
+
+    if (!GetFileSizeEx(fh, &sz)) {
+        sys_error x(path);
+        CloseHandle(fh);
+        throw x;
+    }
+
+    if (sz.QuadPart > 0) {
+        HANDLE mh = CreateFileMappingW(fh, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        void * p = mh ? MapViewOfFile(mh, FILE_MAP_READ, 0, 0, 0) : nullptr;
+
+        if (!p) {
+            sys_error x(path);
+            if (mh) { CloseHandle(mh); }
+            CloseHandle(fh);
+            throw x;
+        }
+
+        CloseHandle(mh);
+        handle_ = p;
+        data_ = static_cast<const char *>(p);
+        size_ = sz.QuadPart;
+    }
+
+    CloseHandle(fh);
+}
+
+File_map::~File_map() {
+    if (handle_) { UnmapViewOfFile(handle_); }
+}
+
 std::wstring str_to_wstring(const ustring & str) {
     std::wstring ws;
 
@@ -122,6 +122,13 @@ void Winface_win::invalidate(const Rect & r) {
     InvalidateRect(hwnd_, &wr, FALSE);
 }
 
+// Overrides pure Winface.
+// ScrollWindowEx() also moves pending update region within the area.
+bool Winface_win::scroll(const Rect & area, const Point & delta) {
+    RECT wr = to_winrect(area);
+    return ERROR != ScrollWindowEx(hwnd_, delta.x(), delta.y(), &wr, &wr, NULL, NULL, SW_INVALIDATE);
+}
+
 // Overrides pure Winface.
 Painter_ptr Winface_win::painter() {
     return std::make_shared<Painter_win>(this);
@@ -52,6 +52,9 @@ public:
     // Overrides pure Winface.
     void invalidate(const Rect & inval) override;
 
+    // Overrides pure Winface.
+    bool scroll(const Rect & area, const Point & delta) override;
+
     // Overrides pure Winface.
     Painter_ptr painter() override;
 
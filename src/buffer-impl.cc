@@ -28,9 +28,15 @@
 #include <tau/locale.hh>
 #include <tau/string.hh>
 #include <buffer-impl.hh>
+#include <event-impl.hh>
+#include <loop-impl.hh>
+#include <utf-impl.hh>
+#include <algorithm>
 #include <array>
+#include <cstring>
 #include <fstream>
 #include <iostream>
+#include <sstream>
 
 namespace tau {
 
@@ -683,11 +689,485 @@ bool Buffer_citer::equals(const std::u32string & text, bool advance) {
 // --------------------------------------------------------------------------
 // --------------------------------------------------------------------------
 
+namespace {
+
+const std::size_t BLOCK_MAX  = 1024;    // Maximal row count per block.
+const std::size_t BLOCK_FILL = 512;     // Row count for newly created blocks.
+
+} // anonymous namespace
+
+Buffer_rows::~Buffer_rows() {
+    clear();
+}
+
+void Buffer_rows::clear() {
+    for (Lines * blk: blocks_) { delete blk; }
+    blocks_.clear();
+    starts_.clear();
+    valid_ = 0;
+    hint_ = 0;
+    rows_ = 0;
+    size_ = 0;
+}
+
+void Buffer_rows::invalidate(std::size_t bi) {
+    valid_ = std::min(valid_, bi);
+}
+
+std::size_t Buffer_rows::locate(std::size_t & row) const {
+    std::size_t nb = blocks_.size();
+
+    if (valid_ < nb) {
+        starts_.resize(nb);
+        std::size_t first = 0 == valid_ ? 0 : starts_[valid_-1]+blocks_[valid_-1]->size();
+        for (std::size_t i = valid_; i < nb; ++i) { starts_[i] = first; first += blocks_[i]->size(); }
+        valid_ = nb;
+    }
+
+    std::size_t bi = hint_;
+
+    if (bi >= nb || row < starts_[bi] || row >= starts_[bi]+blocks_[bi]->size()) {
+        bi = std::upper_bound(starts_.begin(), starts_.begin()+nb, row)-starts_.begin()-1;
+        hint_ = bi;
+    }
+
+    row -= starts_[bi];
+    return bi;
+}
+
+const std::u32string & Buffer_rows::operator[](std::size_t row) const {
+    std::size_t bi = locate(row);
+    return (*blocks_[bi])[row];
+}
+
+std::u32string & Buffer_rows::at(std::size_t row) {
+    std::size_t bi = locate(row);
+    return (*blocks_[bi])[row];
+}
+
+void Buffer_rows::insert_rows(std::size_t row, Lines && lines) {
+    std::size_t n = lines.size(), bi, ofs = row;
+    if (0 == n) { return; }
+    for (auto & s: lines) { size_ += s.size(); }
+
+    if (blocks_.empty()) {
+        blocks_.push_back(new Lines);
+        bi = 0, ofs = 0;
+    }
+
+    else if (row >= rows_) {
+        bi = blocks_.size()-1;
+        ofs = blocks_[bi]->size();
+    }
+
+    else {
+        bi = locate(ofs);
+    }
+
+    Lines * blk = blocks_[bi];
+    invalidate(bi);
+    rows_ += n;
+
+    if (blk->size()+n <= BLOCK_MAX) {
+        blk->insert(blk->begin()+ofs, std::make_move_iterator(lines.begin()), std::make_move_iterator(lines.end()));
+        return;
+    }
+
+    // Split the block at insertion point, the tail goes into the last new block.
+    Lines tail(std::make_move_iterator(blk->begin()+ofs), std::make_move_iterator(blk->end()));
+    blk->erase(blk->begin()+ofs, blk->end());
+    std::vector<Lines *> bs;
+
+    for (std::size_t i = 0; i < n; i += BLOCK_FILL) {
+        auto b = lines.begin()+i, e = lines.begin()+std::min(n, i+BLOCK_FILL);
+        bs.push_back(new Lines(std::make_move_iterator(b), std::make_move_iterator(e)));
+    }
+
+    if (!tail.empty()) {
+        Lines * last = bs.back();
+        if (last->size()+tail.size() <= BLOCK_MAX) { last->insert(last->end(), std::make_move_iterator(tail.begin()), std::make_move_iterator(tail.end())); }
+        else { bs.push_back(new Lines(std::move(tail))); }
+    }
+
+    if (blk->empty()) { delete blk; blocks_.erase(blocks_.begin()+bi); }
+    else { ++bi; }
+    blocks_.insert(blocks_.begin()+bi, bs.begin(), bs.end());
+}
+
+void Buffer_rows::erase_rows(std::size_t row, std::size_t nrows) {
+    if (row >= rows_) { return; }
+    nrows = std::min(nrows, rows_-row);
+    if (0 == nrows) { return; }
+
+    std::size_t ofs = row, bi = locate(ofs), first = bi;
+    invalidate(bi);
+    rows_ -= nrows;
+
+    if (0 != ofs) {
+        Lines * blk = blocks_[bi];
+        auto b = blk->begin()+ofs, e = b+std::min(nrows, blk->size()-ofs);
+        for (auto i = b; i != e; ++i) { size_ -= i->size(); }
+        nrows -= e-b;
+        blk->erase(b, e);
+        ++bi;
+    }
+
+    std::size_t end = bi;
+
+    for (; 0 != nrows && end < blocks_.size() && blocks_[end]->size() <= nrows; ++end) {
+        for (auto & s: *blocks_[end]) { size_ -= s.size(); }
+        nrows -= blocks_[end]->size();
+        delete blocks_[end];
+    }
+
+    blocks_.erase(blocks_.begin()+bi, blocks_.begin()+end);
+
+    if (0 != nrows) {
+        Lines * blk = blocks_[bi];
+        for (auto i = blk->begin(); i != blk->begin()+nrows; ++i) { size_ -= i->size(); }
+        blk->erase(blk->begin(), blk->begin()+nrows);
+    }
+
+    // Merge small neighbours.
+    for (std::size_t i = 0 != first ? first-1 : 0; i <= first && i+1 < blocks_.size(); ) {
+        Lines * blk = blocks_[i], * next = blocks_[i+1];
+
+        if (blk->size()+next->size() <= BLOCK_FILL) {
+            blk->insert(blk->end(), std::make_move_iterator(next->begin()), std::make_move_iterator(next->end()));
+            delete next;
+            blocks_.erase(blocks_.begin()+i+1);
+            invalidate(i);
+        }
+
+        else {
+            ++i;
+        }
+    }
+}
+
+void Buffer_rows::insert(std::size_t row, std::size_t col, const std::u32string & str, std::size_t pos, std::size_t n) {
+    std::u32string & s = at(row);
+    std::size_t len = s.size();
+    s.insert(col, str, pos, n);
+    size_ += s.size()-len;
+}
+
+void Buffer_rows::erase(std::size_t row, std::size_t col, std::size_t n) {
+    std::u32string & s = at(row);
+    std::size_t len = s.size();
+    s.erase(col, n);
+    size_ -= len-s.size();
+}
+
+void Buffer_rows::append(std::size_t row, const std::u32string & str, std::size_t pos) {
+    std::u32string & s = at(row);
+    std::size_t len = s.size();
+    s.append(str, pos, std::u32string::npos);
+    size_ += s.size()-len;
+}
+
+void Buffer_rows::replace(std::size_t row, std::size_t col, std::size_t n, const std::u32string & str, std::size_t pos, std::size_t n2) {
+    std::u32string & s = at(row);
+    std::size_t len = s.size();
+    s.replace(col, n, str, pos, n2);
+    size_ += s.size();
+    size_ -= len;
+}
+
+// --------------------------------------------------------------------------
+// --------------------------------------------------------------------------
+
+namespace {
+
+// Decodes character of UTF-8 row, invalid byte (mapped file modified meanwhile)
+// taken as ISO-8859-1 character. Returns length in bytes, never 0.
+std::size_t utf8_step(const char * p, const char * end, char32_t & wc) {
+    std::size_t len = utf8_char(p, end, wc);
+    if (0 != len) { return len; }
+    wc = uint8_t(*p);
+    return 1;
+}
+
+} // anonymous namespace
+
+// Row indexer, can be resumed at any byte.
+class Buffer_bytes::Indexer {
+public:
+
+    // If fallback is true, rows which are not valid UTF-8 are indexed as 8-bit.
+    Indexer(const char * data, std::size_t size, bool utf8, bool fallback, std::size_t start=0):
+        data_(data),
+        size_(size),
+        utf8_(utf8),
+        fallback_(fallback),
+        row_(start),
+        pos_(start)
+    {
+    }
+
+    // Byte offset of current (incomplete) row.
+    std::size_t row() const { return row_; }
+
+    // Index bytes up to end, complete rows are appended to batch.
+    // Returns false on invalid UTF-8 if fallback not allowed.
+    bool run(std::size_t end, Batch & batch) {
+        while (pos_ < end) {
+            // Plain 7-bit run needs neither decoding nor row break check.
+            if (std::size_t k = ascii_run(data_+pos_, end-pos_)) {
+                for (std::size_t c = 0 != nchars_ ? (nchars_+CKPT-1)/CKPT*CKPT : CKPT; c < nchars_+k; c += CKPT) {
+                    ckpts_.push_back(pos_+c-nchars_-row_);
+                }
+
+                pos_ += k, nchars_ += k;
+                if (pos_ == end) { break; }
+            }
+
+            const char * p = data_+pos_;
+            std::size_t len = 1;
+            char32_t wc;
+
+            if (!utf8_ || bit8_) {
+                wc = uint8_t(*p);
+            }
+
+            else {
+                len = utf8_char(p, data_+size_, wc);
+
+                if (0 == len) {
+                    if (!fallback_) { return false; }
+                    bit8_ = true, pos_ = row_, nchars_ = 0;
+                    ckpts_.clear();
+                    continue;
+                }
+            }
+
+            if (0 != nchars_ && 0 == nchars_ % CKPT) { ckpts_.push_back(pos_-row_); }
+            pos_ += len, ++nchars_;
+
+            if (0x000a == wc || 0x000d == wc || 0x2028 == wc || 0x2029 == wc) {
+                if (pos_ < size_ && ((0x000a == wc && '\r' == data_[pos_]) || (0x000d == wc && '\n' == data_[pos_]))) {
+                    if (0 == nchars_ % CKPT) { ckpts_.push_back(pos_-row_); }
+                    ++pos_, ++nchars_;
+                }
+
+                add_row(batch);
+            }
+        }
+
+        return true;
+    }
+
+    // Append the last row, even if empty.
+    void finish(Batch & batch) {
+        add_row(batch);
+    }
+
+private:
+
+    void add_row(Batch & batch) {
+        std::size_t ck = std::u32string::npos;
+
+        // Column equals to byte offset if there are no multibyte characters, checkpoints not needed.
+        if (pos_-row_ != nchars_) {
+            ck = batch.ckpts.size();
+            batch.ckpts.insert(batch.ckpts.end(), ckpts_.begin(), ckpts_.end());
+        }
+
+        batch.rows.push_back({ row_, nchars_, ck });
+        batch.size += nchars_;
+        row_ = pos_, nchars_ = 0, bit8_ = false;
+        ckpts_.clear();
+    }
+
+private:
+
+    const char *                data_;
+    std::size_t                 size_;
+    bool                        utf8_;
+    bool                        fallback_;
+    std::size_t                 row_;               // Current row start.
+    std::size_t                 pos_;               // Current position.
+    bool                        bit8_ = false;      // Current row is not valid UTF-8.
+    std::size_t                 nchars_ = 0;        // Character count within current row.
+    std::vector<std::size_t>    ckpts_;             // Checkpoints within current row.
+};
+
+Buffer_bytes::~Buffer_bytes() {
+    stop_ = true;
+    if (thr_.joinable()) { thr_.join(); }
+}
+
+void Buffer_bytes::take(Batch & batch) {
+    std::size_t base = ckpts_.size();
+
+    for (const Row & r: batch.rows) {
+        rows_.push_back({ r.ofs, r.len, std::u32string::npos != r.ck ? base+r.ck : r.ck });
+    }
+
+    ckpts_.insert(ckpts_.end(), batch.ckpts.begin(), batch.ckpts.end());
+    size_ += batch.size;
+    last_row_ = std::u32string::npos;
+}
+
+void Buffer_bytes::assign(std::string && bytes, bool utf8) {
+    bytes_ = std::move(bytes);
+    data_ = bytes_.data();
+    nbytes_ = bytes_.size();
+    Batch batch;
+    Indexer ix(data_, nbytes_, utf8, false);
+    utf8_ = utf8 && ix.run(nbytes_, batch);
+
+    if (utf8_) {
+        if (0 != nbytes_) { ix.finish(batch); }
+    }
+
+    else {
+        batch = Batch();
+        Indexer ix8(data_, nbytes_, false, false);
+        ix8.run(nbytes_, batch);
+        if (0 != nbytes_) { ix8.finish(batch); }
+    }
+
+    rows_.clear();
+    ckpts_.clear();
+    size_ = 0;
+    take(batch);
+    rows_.shrink_to_fit();
+    ckpts_.shrink_to_fit();
+    indexed_ = nbytes_;
+}
+
+void Buffer_bytes::map(const ustring & path, Event_ptr ready) {
+    map_ = std::make_unique<File_map>(path);
+    data_ = map_->data();
+    nbytes_ = map_->size();
+    utf8_ = true;
+    bom_ = nbytes_ >= 3 && 0 == std::memcmp(data_, "\xef\xbb\xbf", 3);
+
+    if (nbytes_ > (bom_ ? 3 : 0)) {
+        indexing_ = true;
+        thr_ = std::thread(&Buffer_bytes::index_thread, this, ready);
+    }
+}
+
+// Runs within indexing thread.
+void Buffer_bytes::index_thread(Event_ptr ready) {
+    Indexer ix(data_, nbytes_, true, true, bom_ ? 3 : 0);
+
+    // The first chunk is small, so the first screen becomes available quickly.
+    for (std::size_t end = 0, chunk = 0x10000; !stop_ && end < nbytes_; chunk = 0x400000) {
+        end = std::min(nbytes_, end+chunk);
+        Batch batch;
+        ix.run(end, batch);
+        if (end == nbytes_) { ix.finish(batch); }
+
+        {
+            std::lock_guard<std::mutex> lock(mx_);
+            std::size_t base = pending_.ckpts.size();
+
+            for (Row & r: batch.rows) {
+                if (std::u32string::npos != r.ck) { r.ck += base; }
+                pending_.rows.push_back(r);
+            }
+
+            pending_.ckpts.insert(pending_.ckpts.end(), batch.ckpts.begin(), batch.ckpts.end());
+            pending_.size += batch.size;
+            tail_ = ix.row();
+            done_ = end == nbytes_;
+        }
+
+        ready->emit();
+    }
+}
+
+bool Buffer_bytes::merge() {
+    if (!indexing_) { return false; }
+    Batch batch;
+    std::size_t tail;
+    bool done;
+
+    {
+        std::lock_guard<std::mutex> lock(mx_);
+        std::swap(batch, pending_);
+        tail = tail_;
+        done = done_;
+    }
+
+    if (batch.rows.empty() && !done) { return false; }
+
+    // Replace incomplete row.
+    if (!rows_.empty()) { rows_.pop_back(); }
+    take(batch);
+
+    if (done) {
+        indexing_ = false;
+        indexed_ = nbytes_;
+        if (thr_.joinable()) { thr_.join(); }
+    }
+
+    else {
+        rows_.push_back({ tail, 0, std::u32string::npos });
+        indexed_ = tail;
+    }
+
+    return true;
+}
+
+void Buffer_bytes::wait() {
+    if (thr_.joinable()) { thr_.join(); }
+}
+
+std::size_t Buffer_bytes::locate(std::size_t row, std::size_t col) const {
+    const Row & r = rows_[row];
+    if (std::u32string::npos == r.ck) { return r.ofs+col; }
+
+    std::size_t k = col/CKPT, c = k*CKPT, ofs = 0 != k ? ckpts_[r.ck+k-1] : 0;
+    if (row == last_row_ && last_col_ <= col && last_col_ > c) { c = last_col_, ofs = last_ofs_; }
+    const char * base = data_+r.ofs, * p = base+ofs, * end = data_+nbytes_;
+    for (char32_t wc; c < col && p < end; ++c) { p += utf8_step(p, end, wc); }
+    last_row_ = row, last_col_ = col, last_ofs_ = p-base;
+    return p-data_;
+}
+
+char32_t Buffer_bytes::at(std::size_t row, std::size_t col) const {
+    const char * p = data_+locate(row, col);
+    if (std::u32string::npos == rows_[row].ck) { return uint8_t(*p); }
+    char32_t wc = 0;
+    if (p < data_+nbytes_) { utf8_step(p, data_+nbytes_, wc); }
+    return wc;
+}
+
+void Buffer_bytes::get(std::size_t row, std::size_t col, std::size_t n, std::u32string & s) const {
+    const Row & r = rows_[row];
+
+    if (col < r.len) {
+        n = std::min(n, r.len-col);
+        const char * p = data_+locate(row, col), * end = data_+nbytes_;
+        s.reserve(s.size()+n);
+
+        if (std::u32string::npos == r.ck) {
+            for (; 0 != n; --n) { s += char32_t(uint8_t(*p++)); }
+        }
+
+        else {
+            for (char32_t wc = 0; 0 != n && p < end; --n) { p += utf8_step(p, end, wc); s += wc; }
+        }
+    }
+}
+
+// --------------------------------------------------------------------------
+// --------------------------------------------------------------------------
+
 Buffer_impl::Buffer_impl() {
     newlines_ = str_newlines();
 }
 
 Buffer_impl::~Buffer_impl() {
+    // Pending event must not reach on_indexed() of destroyed object.
+    indexed_cx_.drop();
+    event_.reset();
+    bytes_.reset();
+
     if (signal_erase_) { delete signal_erase_; }
     if (signal_insert_) { delete signal_insert_; }
     if (signal_replace_) { delete signal_replace_; }
@@ -697,29 +1177,33 @@ Buffer_impl::~Buffer_impl() {
     if (signal_unlock_) { delete signal_unlock_; }
     if (signal_encoding_changed_) { delete signal_encoding_changed_; }
     if (signal_bom_changed_) { delete signal_bom_changed_; }
+    if (signal_progress_) { delete signal_progress_; }
 }
 
 std::size_t Buffer_impl::size() const {
-    std::size_t sz = 0;
-    for (auto & row: rows_) { sz += row.s.size(); }
-    return sz;
+    return bytes_ ? bytes_->size() : rows_.size();
 }
 
 std::size_t Buffer_impl::rows() const {
-    return rows_.size();
+    return bytes_ ? bytes_->rows() : rows_.rows();
 }
 
 std::size_t Buffer_impl::length(std::size_t row) const {
-    return row < rows_.size() ? rows_[row].s.size() : 0;
+    if (bytes_) { return row < bytes_->rows() ? bytes_->length(row) : 0; }
+    return row < rows_.rows() ? rows_[row].size() : 0;
 }
 
 bool Buffer_impl::empty() const {
-    return rows_.empty();
+    return bytes_ ? 0 == bytes_->rows() : rows_.empty();
 }
 
 char32_t Buffer_impl::at(std::size_t row, std::size_t col) const {
-    if (row < rows_.size()) {
-        auto & s = rows_[row].s;
+    if (bytes_) {
+        return row < bytes_->rows() && col < bytes_->length(row) ? bytes_->at(row, col) : 0;
+    }
+
+    if (row < rows_.rows()) {
+        auto & s = rows_[row];
         if (col < s.size()) { return s[col]; }
     }
 
@@ -730,17 +1214,30 @@ std::u32string Buffer_impl::text(std::size_t r1, std::size_t c1, std::size_t r2,
     if (r1 > r2) { std::swap(r1, r2); std::swap(c1, c2); }
     if (r1 == r2 && c1 > c2) { std::swap(c1, c2); }
 
-    std::size_t nrows = rows_.size();
+    std::size_t nrows = rows();
     std::u32string s;
 
+    if (bytes_) {
+        while (r1 < r2 && r1 < nrows) {
+            bytes_->get(r1, c1, std::u32string::npos, s);
+            ++r1, c1 = 0;
+        }
+
+        if (r1 == r2 && r1 < nrows && c2 > c1) {
+            bytes_->get(r1, c1, c2-c1, s);
+        }
+
+        return s;
+    }
+
     while (r1 < r2 && r1 < nrows) {
-        const std::u32string & d = rows_[r1].s;
+        const std::u32string & d = rows_[r1];
         s += d.substr(c1);
         ++r1, c1 = 0;
     }
 
     if (r1 == r2 && r1 < nrows) {
-        const std::u32string & d = rows_[r1].s;
+        const std::u32string & d = rows_[r1];
 
         if (c1 < d.size() && c2 > c1) {
             s += d.substr(c1, c2-c1);
@@ -754,18 +1251,16 @@ std::size_t Buffer_impl::length(std::size_t r1, std::size_t c1, std::size_t r2,
     if (r1 > r2) { std::swap(r1, r2); std::swap(c1, c2); }
     if (r1 == r2 && c1 > c2) { std::swap(c1, c2); }
 
-    std::size_t nrows = rows_.size(), result = 0;
+    std::size_t nrows = rows(), result = 0;
 
     while (r1 < r2 && r1 < nrows) {
-        const std::u32string & d = rows_[r1].s;
-        std::size_t len = d.size(), cm = std::min(len, c1);
+        std::size_t len = length(r1), cm = std::min(len, c1);
         result += len-cm;
         ++r1, c1 = 0;
     }
 
     if (r1 == r2 && r1 < nrows) {
-        const std::u32string & d = rows_[r1].s;
-        std::size_t len = d.size();
+        std::size_t len = length(r1);
 
         if (c1 < len && c2 > c1) {
             c2 = std::min(c2, len);
@@ -781,6 +1276,8 @@ Buffer_citer Buffer_impl::insert(Buffer_citer i, const std::u32string & str) {
         return i;
     }
 
+    expand();
+
     Buffer_citer e(i);
     std::size_t n = 0, len = str.size(), row, col;
 
@@ -789,56 +1286,53 @@ Buffer_citer Buffer_impl::insert(Buffer_citer i, const std::u32string & str) {
         col = 0;
     }
 
-    else if (i.row() < rows_.size()) {
+    else if (i.row() < rows_.rows()) {
         row = i.row();
-        col = std::min(rows_[row].s.size(), i.col());
+        col = std::min(rows_[row].size(), i.col());
     }
 
     else {
-        row = rows_.size()-1;
-        col = rows_[row].s.size();
+        row = rows_.rows()-1;
+        col = rows_[row].size();
     }
 
-    while (n < len) {
-        std::size_t eol = str.find_first_of(newlines_, n);
+    if (rows_.empty()) { rows_.insert_rows(0, Buffer_rows::Lines(1)); }
+    Buffer_rows::Lines lines;
+    bool tail = true;
 
-        // No EOL character.
-        // Add text at current position and exit.
-        if (std::u32string::npos == eol) {
-            if (rows_.empty()) { rows_.emplace_back(str.substr(n)); }
-            else { rows_[row].s.insert(col, str, n, len-n); }
-            col += len-n;
-            n = len;
-        }
-
-        // Have EOL character.
-        else {
-            // Insert text between col and next at current position.
-            std::u32string::size_type next, eeol;
+    // Split text into lines, each line keeps its EOL character(s).
+    while (n < len) {
+        std::size_t eol = n+find_newline(str.data()+n, len-n), next;
 
-            if (0x000a == str[eol] && eol+1 < len && 0x000d == str[eol+1]) { eeol = eol+2; }
-            else if (0x000d == str[eol] && eol+1 < len && 0x000a == str[eol+1]) { eeol = eol+2; }
-            else { eeol = eol+1; }
+        if (len == eol) { next = len; }
+        else if (0x000a == str[eol] && eol+1 < len && 0x000d == str[eol+1]) { next = eol+2; }
+        else if (0x000d == str[eol] && eol+1 < len && 0x000a == str[eol+1]) { next = eol+2; }
+        else { next = eol+1; }
 
-            std::u32string newline = std::u32string::npos == eeol ? str.substr(eol) : str.substr(eol, eeol-eol);
-            next = eol+newline.size();
+        lines.emplace_back(str, n, next-n);
+        tail = len == eol;
+        n = next;
+    }
 
-            if (rows_.empty()) {
-                rows_.emplace_back(str.substr(n, next-n));
-                rows_.emplace_back();
-            }
+    if (!tail) { lines.emplace_back(); }
 
-            else {
-                std::u32string right = rows_[row].s.substr(col);
-                rows_[row].s.erase(col);
-                rows_[row].s.insert(col, str, n, next-n);
-                rows_.emplace(rows_.begin()+row+1, right);
-            }
+    // No EOL character: add text at current position.
+    if (1 == lines.size()) {
+        rows_.insert(row, col, lines.front(), 0, len);
+        col += len;
+    }
 
-            n = next;
-            ++row;
-            col = 0;
-        }
+    // The first line goes into the current row, the rest of the current row
+    // goes to the end of the last line, all new rows are inserted at once.
+    else {
+        std::size_t nlines = lines.size()-1, last_col = lines.back().size();
+        lines.back().append(rows_[row], col, std::u32string::npos);
+        rows_.erase(row, col);
+        rows_.append(row, lines.front());
+        lines.erase(lines.begin());
+        rows_.insert_rows(row+1, std::move(lines));
+        row += nlines;
+        col = last_col;
     }
 
     changed_ = true;
@@ -852,32 +1346,32 @@ Buffer_citer Buffer_impl::erase(Buffer_citer b, Buffer_citer e) {
     Buffer_citer ret(b);
 
     if (!locked_ && !empty() && b && e && b != e) {
+        expand();
         if (e < b) { std::swap(b, e); }
         std::size_t row1 = b.row(), col1 = b.col(), row2 = e.row(), col2 = e.col();
 
-        if (row1 < rows_.size() && col1 < rows_[row1].s.size()) {
-            row2 = std::min(row2, rows_.size());
+        if (row1 < rows_.rows() && col1 < rows_[row1].size()) {
+            row2 = std::min(row2, rows_.rows());
 
-            if (row2 < rows_.size()) {
-                col2 = std::min(col2, rows_[row2].s.size());
+            if (row2 < rows_.rows()) {
+                col2 = std::min(col2, rows_[row2].size());
                 std::size_t nlines = row2-row1;
                 std::u32string erased_text;
                 if (signal_erase_) { erased_text.assign(text(b.row(), b.col(), e.row(), e.col())); }
 
                 if (0 == nlines) {
                     if (col2 > col1) {
-                        rows_[row1].s.erase(col1, col2-col1);
+                        rows_.erase(row1, col1, col2-col1);
                     }
                 }
 
                 else {
-                    rows_[row1].s.erase(col1);
-                    rows_[row1].s.append(rows_[row2].s.substr(col2));
-                    rows_[row2].s.erase(0, col2);
-                    while (nlines--) { rows_.erase(rows_.begin()+row1+1); }
+                    rows_.erase(row1, col1);
+                    rows_.append(row1, rows_[row2], col2);
+                    rows_.erase_rows(row1+1, nlines);
                 }
 
-                if (1 == rows_.size() && 0 == rows_[0].s.size()) { rows_.clear(); }
+                if (1 == rows_.rows() && rows_[0].empty()) { rows_.clear(); }
                 ret.move_to(row2, col2);
                 changed_ = true;
                 if (signal_erase_) { (*signal_erase_)(b, ret, erased_text); }
@@ -915,239 +1409,218 @@ Buffer_citer Buffer_impl::insert(Buffer_citer iter, std::istream & is) {
         return iter;
     }
 
-    char buffer[2048];
-    char32_t ob[10240];
-    std::size_t fpos = 0, len = 0;
-    bool not8 = false;
-    std::string acc;
-
-    while (!is.eof()) {
-        fpos += len;
-        is.read(buffer, sizeof(buffer));
-        len = is.gcount();
-        if (0 == len) { break; }
-        std::size_t offset = 0, epos = len;
-        char32_t * obp = ob;
-
-        if (0 == fpos) {
-            if (len >= 4 && '\0' == buffer[0] && '\0' == buffer[1] && '\xfe' == buffer[2] && '\xff' == buffer[3]) {
-                offset += 4;
-                len -= 4;
+    // Incomplete sequence at the end of chunk is moved to the beginning
+    // of buffer and completed by the next read. Trailing CR is held back
+    // until the next chunk, so CRLF split between chunks gives single line break.
+    const std::size_t chunk = 65536;
+    std::vector<char> buffer(chunk+8);
+    std::vector<char32_t> ob(chunk+8);
+    std::size_t fpos = 0, tail = 0;
+    bool bom = true, not8 = false, cr = false;
+
+    for (bool eof = false; !eof; ) {
+        is.read(buffer.data()+tail, chunk);
+        std::size_t len = tail+is.gcount(), offset = 0, nchars = 0;
+        eof = !is.good();
+        if (0 == len && !cr) { break; }
+        if (cr) { ob[nchars++] = U'\r'; cr = false; }
+        const char * b = buffer.data();
+
+        if (bom) {
+            bom = false;
+
+            if (len >= 4 && '\0' == b[0] && '\0' == b[1] && '\xfe' == b[2] && '\xff' == b[3]) {
+                offset = 4;
                 change_encoding(utf32be_);
                 enable_bom();
             }
 
-            else if (len >= 4 && '\xff' == buffer[0] && '\xfe' == buffer[1] && '\0' == buffer[2] && '\0' == buffer[3]) {
-                offset += 4;
-                len -= 4;
+            else if (len >= 4 && '\xff' == b[0] && '\xfe' == b[1] && '\0' == b[2] && '\0' == b[3]) {
+                offset = 4;
                 change_encoding(utf32le_);
                 enable_bom();
             }
 
-            else if (len >= 3 && '\xef' == buffer[0] && '\xbb' == buffer[1] && '\xbf' == buffer[2]) {
-                offset += 3;
-                len -= 3;
+            else if (len >= 3 && '\xef' == b[0] && '\xbb' == b[1] && '\xbf' == b[2]) {
+                offset = 3;
                 change_encoding(utf8_);
                 enable_bom();
             }
 
-            else if (len >= 2 && '\xfe' == buffer[0] && '\xff' == buffer[1]) {
-                offset += 2;
-                len -= 2;
+            else if (len >= 2 && '\xfe' == b[0] && '\xff' == b[1]) {
+                offset = 2;
                 change_encoding(utf16be_);
                 enable_bom();
             }
 
-            else if (len >= 2 && '\xff' == buffer[0] && '\xfe' == buffer[1]) {
-                offset += 2;
-                len -= 2;
+            else if (len >= 2 && '\xff' == b[0] && '\xfe' == b[1]) {
+                offset = 2;
                 change_encoding(utf16le_);
                 enable_bom();
             }
         }
 
-        if (utf32be_ == encoding_) {
-            const char * p = buffer+offset;
-
-            while (len >= 4) {
-                char32_t wc = uint8_t(*p++);
-                wc <<= 8; wc += uint8_t(*p++);
-                wc <<= 8; wc += uint8_t(*p++);
-                wc <<= 8; wc += uint8_t(*p++);
-                *obp++ = wc;
-                len -= 4;
-            }
+        if (utf32be_ == encoding_ || utf32le_ == encoding_) {
+            std::size_t n;
+            offset += utf32_decode(b+offset, len-offset, utf32be_ == encoding_, ob.data()+nchars, n);
+            nchars += n;
         }
 
-        else if (utf32le_ == encoding_) {
-            const char * p = buffer+offset;
-
-            while (len >= 4) {
-                char32_t wc = uint8_t(p[3]);
-                wc <<= 8; wc += uint8_t(p[2]);
-                wc <<= 8; wc += uint8_t(p[1]);
-                wc <<= 8; wc += uint8_t(p[0]);
-                *obp++ = wc;
-                p += 4;
-                len -= 4;
-            }
-        }
+        else if (utf16be_ == encoding_ || utf16le_ == encoding_) {
+            bool be = utf16be_ == encoding_;
 
-        else if (utf16be_ == encoding_) {
-            const char * p = buffer+offset;
-            char16_t sur = 0;
+            for (;;) {
+                std::size_t n;
+                offset += utf16_decode(b+offset, len-offset, be, ob.data()+nchars, n);
+                nchars += n;
+                std::size_t rest = len-offset;
+                if (rest < 2) { break; }
+                const uint8_t * u = reinterpret_cast<const uint8_t *>(b+offset);
+                char16_t wc = be ? (u[0] << 8) | u[1] : (u[1] << 8) | u[0];
 
-            while (len >= 2) {
-                char16_t wc = uint8_t(*p++);
-                wc <<= 8; wc += uint8_t(*p++);
+                // High surrogate at the end of chunk, wait for the pair.
+                if (!eof && rest < 4 && 0xd800 == (0xfc00 & wc)) { break; }
 
-                if (0 != sur) {
-                    if (char16_is_surrogate(wc)) {
-                        *obp++ = char32_from_surrogate(sur, wc);
-                    }
-
-                    // FIXME Simply skip character on error? Is it correct?
-                    else {
-                        std::cerr << "** Buffer::insert(stream): (" << encoding_.name() << "), position "
-                        << fpos+offset << ": skip surrogate (?) pair " << std::hex << std::showbase
-                        << sur << ':' << std::hex << std::showbase << wc << std::dec << std::endl;
-                    }
-
-                    sur = 0;
-                }
-
-                else {
-                    if (char16_is_surrogate(wc)) {
-                        sur = wc;
-                    }
-
-                    else {
-                        *obp++ = char32_t(wc);
-                    }
-                }
-
-                len -= 2;
+                // FIXME Simply skip character on error? Is it correct?
+                std::cerr << "** Buffer::insert(stream): (" << encoding_.name() << "), position "
+                << fpos+offset << ": skip surrogate (?) " << std::hex << std::showbase << wc << std::dec << std::endl;
                 offset += 2;
             }
         }
 
-        else if (utf16le_ == encoding_) {
-            const char * p = buffer+offset;
-            char16_t sur = 0;
-
-            while (len >= 2) {
-                char16_t wc = uint8_t(p[1]);
-                wc <<= 8; wc += uint8_t(p[0]);
-
-                if (0 != sur) {
-                    if (char16_is_surrogate(wc)) {
-                        *obp++ = char32_from_surrogate(sur, wc);
-                    }
-
-                    // FIXME Simply skip character on error? Is it correct?
-                    else {
-                        std::cerr << "** Buffer::insert(stream): (" << encoding_.name() << "), position "
-                        << fpos+offset << ": skip surrogate (?) pair " << std::hex << std::showbase
-                        << sur << ':' << std::hex << std::showbase << wc << std::dec << std::endl;
-                    }
-
-                    sur = 0;
+        // Assume UTF-8?
+        else {
+            if (!not8) {
+                std::size_t n;
+                offset += utf8_decode(b+offset, len-offset, ob.data()+nchars, n);
+                nchars += n;
+                std::size_t rest = len-offset;
+
+                // Invalid sequence or incomplete one at the end of stream: assume encoding is not UTF-8.
+                if (0 != rest && (eof || rest >= 4 || utf8_len(b[offset]) <= rest || 1 == utf8_len(b[offset]))) {
+                    not8 = true;
                 }
+            }
 
-                else {
-                    if (char16_is_surrogate(wc)) {
-                        sur = wc;
-                    }
+            // Not UTF-8, fall back to ISO-8859-1 as compact storage does.
+            if (not8) {
+                change_encoding(Encoding("ISO-8859-1"));
 
-                    else {
-                        *obp++ = char32_t(wc);
+                for (; offset < len; ++offset) {
+                    if (uint8_t c = b[offset]) {
+                        ob[nchars++] = c;
                     }
                 }
-
-                p += 2;
-                len -= 2;
-                offset += 2;
             }
         }
 
-        // Assume UTF-8?
-        else {
-            if (!not8) {
-                // Incomplete sequence stored in acc.
-                if (!acc.empty()) {
-                    std::size_t u8len = utf8_len(acc[0]), more = u8len-acc.size();
+        if (!eof && 0 != nchars && U'\r' == ob[nchars-1]) { --nchars; cr = true; }
+        if (0 != nchars) { iter = insert(iter, std::u32string(ob.data(), nchars)); }
+        tail = len-offset;
+        std::memmove(buffer.data(), b+offset, tail);
+        fpos += offset;
+    }
 
-                    // Assume encoding is not UTF-8.
-                    if (more > len) {
-                        not8 = true;
-                    }
+    return iter;
+}
 
-                    else {
-                        while (0 != more--) { acc += buffer[offset++]; }
-                        ustring uacc(acc);
-                        *obp++ = char32_t(uacc[0]);
-                        offset += more;
-                        acc.clear();
-                    }
-                }
-            }
+Buffer_citer Buffer_impl::load_compact(Buffer_citer i, std::istream & is) {
+    if (locked_ || !is.good()) {
+        return i;
+    }
 
-            if (!not8) {
-                int n8bytes = 7;
+    std::string bytes;
+    std::istream::pos_type pos = is.tellg();
+
+    // Seekable stream: read at once.
+    if (-1 != pos) {
+        is.seekg(0, std::ios::end);
+        std::istream::pos_type epos = is.tellg();
+        is.seekg(pos);
+        if (-1 != epos && epos > pos) { bytes.resize(epos-pos); }
+        is.read(&bytes[0], bytes.size());
+        bytes.resize(is.gcount());
+    }
 
-                for (std::size_t pos = epos-1; pos >= offset && (buffer[pos] < 0) && n8bytes; --pos, --n8bytes) {
-                    char c = buffer[pos];
+    for (char buffer[16384]; is.good(); ) {
+        is.read(buffer, sizeof(buffer));
+        bytes.append(buffer, is.gcount());
+    }
 
-                    // Found UTF-8 sequence leader character?
-                    if ('\xc0' == ('\xc0' & c)) {
+    std::size_t n = bytes.size();
+    bool unicode = (n >= 2 && ("\xfe\xff" == bytes.substr(0, 2) || "\xff\xfe" == bytes.substr(0, 2)))
+                || (n >= 4 && 0 == bytes.compare(0, 4, "\0\0\xfe\xff", 4));
 
-                        // Has incomplete sequence within buffer?
-                        if (utf8_len(c) > epos-pos) {
-                            acc.assign(buffer+pos-1, epos-pos);
-                            epos = pos;
-                            // std::cout << "c0 " << " " << epos << " " << epos-pos << "\n";
-                        }
+    // UTF-16 and UTF-32 are not stored compact.
+    if (unicode || !empty() || utf16be_ == encoding_ || utf16le_ == encoding_ || utf32be_ == encoding_ || utf32le_ == encoding_) {
+        std::istringstream ss(std::move(bytes));
+        return insert(i, ss);
+    }
 
-                        break;
-                    }
-                }
+    if (n >= 3 && 0 == bytes.compare(0, 3, "\xef\xbb\xbf")) {
+        bytes.erase(0, 3);
+        change_encoding(utf8_);
+        enable_bom();
+    }
 
-                not8 = !n8bytes;
-            }
+    if (bytes.empty()) {
+        return i;
+    }
 
-            if (!not8) {
-                for (const char * p = buffer+offset; offset < epos; p = utf8_next(p)) {
-                    char32_t wc = char32_from_pointer(p);
-
-                    if (!wc) {
-                        not8 = true;
-                        iter = insert(iter, std::u32string(ob, obp-ob));
-                        obp = ob;
-                        // std::cout << "non UTF-8 " << fpos+offset << " " << acc.size() << "\n";
-                        break;
-                    }
+    bytes_ = std::make_unique<Buffer_bytes>();
+    bytes_->assign(std::move(bytes), true);
+    if (!bytes_->utf8()) { change_encoding(Encoding("ISO-8859-1")); }
 
-                    *obp++ = wc;
-                    offset += utf8_len(*p);
-                }
-            }
+    std::size_t row = bytes_->rows()-1;
+    Buffer_citer e(i, row, bytes_->length(row));
+    changed_ = true;
+    if (signal_insert_) { (*signal_insert_)(i, e); }
+    if (signal_changed_) { (*signal_changed_)(); }
+    return e;
+}
 
-            // Not UTF-8, so far simply skip non UTF-8 characters.
-            if (not8) {
-                change_encoding(Encoding("ASCII"));
+void Buffer_impl::load_mapped(Buffer_ptr self, const ustring & path) {
+    self_ = self;
+    event_ = Loop_impl::this_loop()->create_event();
+    indexed_cx_ = event_->signal_ready().connect(fun(this, &Buffer_impl::on_indexed));
+    bytes_ = std::make_unique<Buffer_bytes>();
+    bytes_->map(path, event_);
+    bom_ = bytes_->bom();
+    locked_ = true;
+}
 
-                for (const char * p = buffer+offset; p < buffer+epos; ++p) {
-                    if (*p > 0) {
-                        *obp++ = char32_t(*p);
-                    }
-                }
+void Buffer_impl::on_indexed() {
+    if (bytes_) {
+        std::size_t row = bytes_->rows();
+
+        if (bytes_->merge()) {
+            if (auto self = self_.lock()) {
+                std::size_t last = bytes_->rows()-1;
+                Buffer_citer b(Buffer_citer_impl::create(self, 0 != row ? row-1 : 0, 0));
+                Buffer_citer e(Buffer_citer_impl::create(self, last, bytes_->length(last)));
+                if (signal_insert_) { (*signal_insert_)(b, e); }
+                if (signal_changed_) { (*signal_changed_)(); }
             }
-        }
 
-        iter = insert(iter, std::u32string(ob, obp-ob));
+            if (signal_progress_) { (*signal_progress_)(bytes_->indexed(), bytes_->bytes()); }
+        }
     }
+}
 
-    return iter;
+void Buffer_impl::expand() {
+    if (bytes_) {
+        if (bytes_->indexing()) {
+            bytes_->wait();
+            on_indexed();
+        }
+
+        Buffer_rows::Lines lines;
+        lines.reserve(bytes_->rows());
+        bytes_->for_each([&lines](const std::u32string & s) { lines.push_back(s); });
+        bytes_.reset();
+        rows_.clear();
+        rows_.insert_rows(0, std::move(lines));
+    }
 }
 
 Buffer_citer Buffer_impl::replace(Buffer_citer i, const std::u32string & str) {
@@ -1155,14 +1628,16 @@ Buffer_citer Buffer_impl::replace(Buffer_citer i, const std::u32string & str) {
         return i;
     }
 
+    expand();
+
     std::size_t n = 0, len = str.size();
 
     while (n < len) {
-        if (i.row() >= rows_.size()) {
+        if (i.row() >= rows_.rows()) {
             return insert(i, str);
         }
 
-        if (i.row() == rows_.size()-1 && i.col() >= rows_[i.row()].s.size()) {
+        if (i.row() == rows_.rows()-1 && i.col() >= rows_[i.row()].size()) {
             return insert(i, str);
         }
 
@@ -1170,7 +1645,7 @@ Buffer_citer Buffer_impl::replace(Buffer_citer i, const std::u32string & str) {
         if (ustring::npos == eol) { eol = len; }
 
         if (eol > n) {
-            std::u32string & d = rows_[i.row()].s;
+            const std::u32string & d = rows_[i.row()];
             std::size_t d_eol = d.find_first_of(newlines_);
             if (std::u32string::npos == d_eol) { d_eol = d.size(); }
             std::size_t n_repl = std::min(eol-n, (i.col() < d_eol ? d_eol-i.col() : 0));
@@ -1178,7 +1653,7 @@ Buffer_citer Buffer_impl::replace(Buffer_citer i, const std::u32string & str) {
             if (0 != n_repl) {
                 std::u32string replaced_text;
                 if (signal_replace_) { replaced_text.assign(d.substr(i.col(), n_repl)); }
-                d.replace(i.col(), n_repl, str, n, n_repl);
+                rows_.replace(i.row(), i.col(), n_repl, str, n, n_repl);
                 std::size_t col = i.col()+n_repl;
                 auto j = i; j.move_to_col(col);
                 if (signal_replace_) { (*signal_replace_)(i, j, replaced_text); }
@@ -1208,8 +1683,8 @@ void Buffer_impl::save(std::ostream & os) {
     if (utf16be_ == encoding_) {
         if (bom_) { os.write("\xfe\xff", 2); }
 
-        for (auto & row: rows_) {
-            for (char32_t wc: row.s) {
+        for_each_row([&os](const std::u32string & row) {
+            for (char32_t wc: row) {
                 char16_t c1, c2;
                 char32_to_surrogate(wc, c1, c2);
                 os.put(c1);
@@ -1220,14 +1695,14 @@ void Buffer_impl::save(std::ostream & os) {
                     os.put(c2 >> 8);
                 }
             }
-        }
+        });
     }
 
     else if (utf16le_ == encoding_) {
         if (bom_) { os.write("\xff\xfe", 2); }
 
-        for (auto & row: rows_) {
-            for (char32_t wc: row.s) {
+        for_each_row([&os](const std::u32string & row) {
+            for (char32_t wc: row) {
                 char16_t c1, c2;
                 char32_to_surrogate(wc, c1, c2);
                 os.put(c1 >> 8);
@@ -1238,33 +1713,33 @@ void Buffer_impl::save(std::ostream & os) {
                     os.put(c2);
                 }
             }
-        }
+        });
     }
 
     else if (utf32be_ == encoding_) {
         if (bom_) { os.write("\x00\x00\xfe\xff", 4); }
 
-        for (auto & row: rows_) {
-            for (char32_t wc: row.s) {
+        for_each_row([&os](const std::u32string & row) {
+            for (char32_t wc: row) {
                 os.put(wc);
                 os.put(wc >> 8);
                 os.put(wc >> 16);
                 os.put(wc >> 24);
             }
-        }
+        });
     }
 
     else if (utf32le_ == encoding_) {
         if (bom_) { os.write("\xff\xfe\x00\x00", 4); }
 
-        for (auto & row: rows_) {
-            for (char32_t wc: row.s) {
+        for_each_row([&os](const std::u32string & row) {
+            for (char32_t wc: row) {
                 os.put(wc >> 24);
                 os.put(wc >> 16);
                 os.put(wc >> 8);
                 os.put(wc);
             }
-        }
+        });
     }
 
     else {
@@ -1274,10 +1749,10 @@ void Buffer_impl::save(std::ostream & os) {
             }
         }
 
-        for (auto & row: rows_) {
-            ustring s(row.s);
+        for_each_row([&os](const std::u32string & row) {
+            ustring s(row);
             os.write(s.c_str(), s.bytes());
-        }
+        });
     }
 
     changed_ = false;
@@ -1359,6 +1834,11 @@ signal<void()> & Buffer_impl::signal_bom_changed() {
     return *signal_bom_changed_;
 }
 
+signal<void(std::size_t, std::size_t)> & Buffer_impl::signal_progress() {
+    if (!signal_progress_) {  signal_progress_ = new signal<void(std::size_t, std::size_t)>; }
+    return *signal_progress_;
+}
+
 } // namespace tau
 
 //END
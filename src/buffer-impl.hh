@@ -29,6 +29,12 @@
 
 #include <tau/buffer.hh>
 #include <tau/encoding.hh>
+#include <sys-impl.hh>
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
 
 namespace tau {
 
@@ -47,6 +53,198 @@ struct Buffer_citer_impl {
     bool        heap_ = false;
 };
 
+// Row storage: rows are kept in blocks of limited size, the blocks are indexed
+// by their first row numbers. The index is rebuilt lazily starting from the
+// lowest modified block, so bulk insertion and erasure of rows moves block
+// pointers rather than the rows themselves.
+class Buffer_rows {
+public:
+
+    using Lines = std::vector<std::u32string>;
+
+    Buffer_rows() = default;
+   ~Buffer_rows();
+
+    Buffer_rows(const Buffer_rows & other) = delete;
+    Buffer_rows & operator=(const Buffer_rows & other) = delete;
+
+    // Total character count.
+    std::size_t size() const { return size_; }
+
+    std::size_t rows() const { return rows_; }
+    bool empty() const { return 0 == rows_; }
+    void clear();
+
+    // Row must exist.
+    const std::u32string & operator[](std::size_t row) const;
+
+    // Insert rows before specified row, the row may be equal to rows().
+    void insert_rows(std::size_t row, Lines && lines);
+
+    // Erase n rows starting from specified row.
+    void erase_rows(std::size_t row, std::size_t nrows);
+
+    // Single row modification, the row must exist.
+    void insert(std::size_t row, std::size_t col, const std::u32string & str, std::size_t pos, std::size_t n);
+    void erase(std::size_t row, std::size_t col, std::size_t n=std::u32string::npos);
+    void append(std::size_t row, const std::u32string & str, std::size_t pos=0);
+    void replace(std::size_t row, std::size_t col, std::size_t n, const std::u32string & str, std::size_t pos, std::size_t n2);
+
+    // Call functor for each row, in order.
+    template<typename Func>
+    void for_each(Func func) const {
+        for (const Lines * blk: blocks_) {
+            for (const std::u32string & s: *blk) {
+                func(s);
+            }
+        }
+    }
+
+private:
+
+    std::vector<Lines *>        blocks_;
+    mutable std::vector<std::size_t> starts_;   // First row numbers of blocks.
+    mutable std::size_t         valid_ = 0;     // Valid items count within starts_.
+    mutable std::size_t         hint_ = 0;      // Last located block.
+    std::size_t                 rows_ = 0;
+    std::size_t                 size_ = 0;
+
+private:
+
+    // Returns block index, row number becomes row offset within block.
+    std::size_t locate(std::size_t & row) const;
+    void invalidate(std::size_t bi);
+    std::u32string & at(std::size_t row);
+};
+
+// Compact read-only storage: text is kept as loaded or mapped bytes, either
+// UTF-8 or 8-bit, and decoded into characters on access. Rows are indexed by
+// byte offsets. Within rows having multibyte characters, byte offset of every
+// CKPT-th character is stored, so column lookup decodes at most CKPT-1
+// characters.
+class Buffer_bytes {
+public:
+
+    static constexpr std::size_t CKPT = 64;
+
+    Buffer_bytes() = default;
+   ~Buffer_bytes();
+
+    Buffer_bytes(const Buffer_bytes & other) = delete;
+    Buffer_bytes & operator=(const Buffer_bytes & other) = delete;
+
+    // Takes loaded bytes and builds row index.
+    // If utf8 is true but the bytes are not valid UTF-8, falls back to 8-bit.
+    void assign(std::string && bytes, bool utf8);
+
+    // Maps the file and starts indexing thread, which emits ready event
+    // every time new rows are indexed. The rows become available after merge().
+    // Rows which are not valid UTF-8 are decoded as 8-bit.
+    // @throw sys_error
+    void map(const ustring & path, Event_ptr ready);
+
+    // Takes rows indexed by the thread so far.
+    // All rows but the last one are complete, the last row is replaced
+    // by next merge() until indexing finished.
+    // Returns false if nothing changed.
+    bool merge();
+
+    // Wait until indexing thread finished, merge() is needed after.
+    void wait();
+
+    // Test if indexing not finished or not merged yet.
+    bool indexing() const { return indexing_; }
+
+    // Merged byte count.
+    std::size_t indexed() const { return indexed_; }
+
+    // Total byte count.
+    std::size_t bytes() const { return nbytes_; }
+
+    // Test if bytes are decoded as UTF-8.
+    bool utf8() const { return utf8_; }
+
+    // Test if mapped file starts with UTF-8 BOM, the BOM is skipped.
+    bool bom() const { return bom_; }
+
+    // Total character count.
+    std::size_t size() const { return size_; }
+
+    std::size_t rows() const { return rows_.size(); }
+
+    // Row must exist.
+    std::size_t length(std::size_t row) const { return rows_[row].len; }
+
+    // Row and column must exist.
+    char32_t at(std::size_t row, std::size_t col) const;
+
+    // Decode up to n characters starting from specified column and append them to s.
+    void get(std::size_t row, std::size_t col, std::size_t n, std::u32string & s) const;
+
+    // Call functor for each decoded row, in order.
+    template<typename Func>
+    void for_each(Func func) const {
+        std::u32string s;
+
+        for (std::size_t row = 0; row < rows_.size(); ++row) {
+            s.clear();
+            get(row, 0, std::u32string::npos, s);
+            func(s);
+        }
+    }
+
+private:
+
+    struct Row {
+        std::size_t     ofs;            // Byte offset of the row.
+        std::size_t     len;            // Character count, including EOL.
+        std::size_t     ck;             // First checkpoint within ckpts_ or npos if row has no multibyte characters.
+    };
+
+    // Indexer output.
+    struct Batch {
+        std::vector<Row>            rows;
+        std::vector<std::size_t>    ckpts;
+        std::size_t                 size = 0;
+    };
+
+    class Indexer;
+
+    const char *                data_ = nullptr;
+    std::size_t                 nbytes_ = 0;
+    std::string                 bytes_;         // Owned bytes, if not mapped.
+    std::unique_ptr<File_map>   map_;
+    std::vector<Row>            rows_;
+    std::vector<std::size_t>    ckpts_;         // Byte offsets from row start.
+    std::size_t                 size_ = 0;
+    std::size_t                 indexed_ = 0;
+    bool                        utf8_ = true;
+    bool                        indexing_ = false;
+    bool                        bom_ = false;
+
+    // Last located position, makes sequential access cheap.
+    mutable std::size_t         last_row_ = std::u32string::npos;
+    mutable std::size_t         last_col_ = 0;
+    mutable std::size_t         last_ofs_ = 0;
+
+    // Shared with indexing thread, guarded by mx_.
+    std::mutex                  mx_;
+    Batch                       pending_;       // Complete rows not merged yet.
+    std::size_t                 tail_ = 0;      // Byte offset of incomplete row.
+    bool                        done_ = false;  // The last row is in pending_.
+
+    std::thread                 thr_;
+    std::atomic<bool>           stop_ { false };
+
+private:
+
+    void take(Batch & batch);
+    void index_thread(Event_ptr ready);
+
+    // Returns byte offset for specified row and column.
+    std::size_t locate(std::size_t row, std::size_t col) const;
+};
+
 struct Buffer_impl {
 
     Buffer_impl();
@@ -69,6 +267,25 @@ struct Buffer_impl {
     void lock();
     void unlock();
 
+    // Load stream into compact storage, falls back to insert() for UTF-16 and UTF-32
+    // and for non-empty buffer.
+    Buffer_citer load_compact(Buffer_citer i, std::istream & is);
+
+    // Map file into compact storage and start indexing it, the buffer becomes locked.
+    void load_mapped(Buffer_ptr self, const ustring & path);
+
+    // Move compact storage content into rows_.
+    void expand();
+
+    // Merge rows indexed by mapped storage.
+    void on_indexed();
+
+    template<typename Func>
+    void for_each_row(Func func) const {
+        if (bytes_) { bytes_->for_each(func); }
+        else { rows_.for_each(func); }
+    }
+
     std::u32string text(std::size_t r1, std::size_t c1, std::size_t r2, std::size_t c2) const;
 
     std::u32string text(Buffer_citer b, Buffer_citer e) const {
@@ -93,17 +310,10 @@ struct Buffer_impl {
     signal<void()> & signal_unlock();
     signal<void(const Encoding &)> & signal_encoding_changed();
     signal<void()> & signal_bom_changed();
+    signal<void(std::size_t, std::size_t)> & signal_progress();
 
-    struct Holder {
-        std::u32string  s;
-
-        Holder() = default;
-        explicit Holder(const std::u32string & str): s(str) {}
-    };
-
-    using Rows = std::vector<Holder>;
-
-    Rows                rows_;
+    Buffer_rows         rows_;
+    std::unique_ptr<Buffer_bytes> bytes_;   // Compact storage, used instead of rows_ until modified.
     bool                locked_ = false;
     bool                bom_ = false;
     bool                changed_ = false;
@@ -115,6 +325,9 @@ struct Buffer_impl {
     Encoding            utf32le_ { "UTF-32LE" };
     std::u32string      newlines_;
     ustring             path_;
+    std::weak_ptr<Buffer_impl> self_;       // Used to emit signals from on_indexed().
+    Event_ptr           event_;             // Emitted by indexing thread.
+    connection          indexed_cx_;        // event_ to on_indexed().
 
     signal<void(Buffer_citer, Buffer_citer, const std::u32string &)> * signal_erase_ = nullptr;
     signal<void(Buffer_citer, Buffer_citer)> * signal_insert_ = nullptr;
@@ -125,6 +338,7 @@ struct Buffer_impl {
     signal<void()> * signal_unlock_ = nullptr;
     signal<void(const Encoding &)> * signal_encoding_changed_ = nullptr;
     signal<void()> * signal_bom_changed_ = nullptr;
+    signal<void(std::size_t, std::size_t)> * signal_progress_ = nullptr;
 };
 
 } // namespace tau
@@ -177,12 +177,20 @@ Buffer_citer Buffer::insert(Buffer_citer iter, std::istream & is) {
 }
 
 // static
-Buffer Buffer::load_from_file(const ustring & path) {
+Buffer Buffer::load_from_file(const ustring & path, int flags) {
+    if (BUFFER_MAPPED & flags) {
+        Buffer buffer;
+        buffer.impl->load_mapped(buffer.impl, path);
+        buffer.impl->path_ = path;
+        return buffer;
+    }
+
     auto & io = Locale().iocharset();
     std::ifstream is(io.is_utf8() ? std::string(path) : io.encode(path), std::ios::binary);
     if (!is.good()) { throw sys_error(path); }
     Buffer buffer;
-    buffer.insert(buffer.cend(), is);
+    if (BUFFER_COMPACT & flags) { buffer.impl->load_compact(buffer.cend(), is); }
+    else { buffer.insert(buffer.cend(), is); }
     buffer.impl->path_ = path;
     return buffer;
 }
@@ -203,6 +211,10 @@ bool Buffer::locked() const {
     return impl->locked_;
 }
 
+bool Buffer::indexing() const {
+    return impl->bytes_ && impl->bytes_->indexing();
+}
+
 void Buffer::enable_bom() {
     impl->enable_bom();
 }
@@ -251,6 +263,10 @@ signal<void()> & Buffer::signal_bom_changed() {
     return impl->signal_bom_changed();
 }
 
+signal<void(std::size_t, std::size_t)> & Buffer::signal_progress() {
+    return impl->signal_progress();
+}
+
 } // namespace tau
 
 //END
@@ -121,15 +121,18 @@ void Container_impl::paint_children(Painter pr, const Rect & inval, bool backpai
         Rect  wbounds(worg-sc, wp->size());
         Rect  intersection = inval & wbounds;
 
-        if (intersection) {
+        // Children outside of damaged region are culled.
+        if (intersection && pp->damaged(intersection.translated(wpos))) {
             pp->wpush();
             pp->poffset(wp->poffset());
             pp->set_obscured_area(intersection.translated(wpos));
             pp->push();
             pp->clear();
             Rect cinval(intersection.translated(sc-worg));
+            pp->profile_enter(wp, backpaint);
             if (backpaint) { wp->handle_backpaint(pr, cinval); }
             else { wp->handle_paint(pr, cinval); }
+            pp->profile_leave();
             pp->pop();
             pp->wpop();
         }
@@ -701,6 +704,11 @@ void Container_impl::show_cursor_up() {
     }
 }
 
+// Overriden by Window_impl.
+void Container_impl::invalidate_up(const Rect & r) {
+    invalidate_parent(r);
+}
+
 // Overriden by Window_impl.
 void Container_impl::queue_arrange_up() {
     if (parent_) { parent_->queue_arrange_up(); }
@@ -197,6 +197,11 @@ public:
     // Overriden by Window_impl.
     virtual Widget_cptr focus_owner() const;
 
+    // Called by children, r is in container coordinates.
+    // Unlike invalidate(), does not drop retained display lists.
+    // Overriden by Window_impl.
+    virtual void invalidate_up(const Rect & r);
+
     std::vector<Widget_ptr> children() { return children_; }
     Widget_ptr cptr(Widget_impl * wi);
     Widget_cptr cptr(const Widget_impl * wi) const;
@@ -0,0 +1,71 @@
+// ----------------------------------------------------------------------------
+// Copyright © 2014-2023 Konstantin Shmelkov <mrcashe@gmail.com>.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+// PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+// OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+// WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+// OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+// EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+// ----------------------------------------------------------------------------
+
+
+#include <tau/string.hh>
+#include <font-impl.hh>
+#include <glyph-impl.hh>
+#include <cmath>
+
+namespace tau {
+
+// public
+int Font_impl::advance(char32_t wc) {
+    if (wc <= 0xffff) {
+        if (index_.empty()) { index_.assign(256, 0); }
+        uint16_t & ix = index_[wc >> 8];
+
+        if (0 == ix) {
+            advs_.resize(advs_.size()+256, -1);
+            ix = advs_.size()/256;
+        }
+
+        int32_t & adv = advs_[256*(ix-1)+(wc & 0xff)];
+        if (adv < 0) { adv = measure(wc); }
+        return adv;
+    }
+
+    auto iter = xadvs_.find(wc);
+    if (iter != xadvs_.end()) { return iter->second; }
+    int adv = measure(wc);
+    xadvs_[wc] = adv;
+    return adv;
+}
+
+// protected
+int Font_impl::measure(char32_t wc) {
+    if (!char32_is_zerowidth(wc)) {
+        if (Glyph_ptr g = glyph(wc)) {
+            return std::ceil(g->advance().x());
+        }
+    }
+
+    return 0;
+}
+
+} // namespace tau
+
+//END
@@ -29,6 +29,8 @@
 
 #include <tau/font.hh>
 #include <types-impl.hh>
+#include <unordered_map>
+#include <vector>
 
 namespace tau {
 
@@ -64,6 +66,29 @@ public:
     virtual Vector max() const = 0;
 
     virtual Glyph_ptr glyph(char32_t wc) = 0;
+
+    // Tests if the font has glyph for the character.
+    // Overridden by Font_posix.
+    virtual bool has_glyph(char32_t wc) const { return true; }
+
+    // Returns glyph advance rounded up to whole pixels, zero width
+    // characters give 0. Advances are cached, so the glyph is looked up
+    // only once per character.
+    int advance(char32_t wc);
+
+protected:
+
+    // Measures uncached advance.
+    // Overridden by Font_xcb.
+    virtual int measure(char32_t wc);
+
+private:
+
+    // BMP advances are stored in 256 entry pages, index_ holds 1+page
+    // number within advs_ or 0 if page not allocated yet.
+    std::vector<uint16_t>   index_;
+    std::vector<int32_t>    advs_;          // -1 means not measured yet.
+    std::unordered_map<char32_t, int> xadvs_; // Advances beyond BMP.
 };
 
 } // namespace tau
@@ -29,6 +29,7 @@
 #ifndef TAU_BUFFER_HH
 #define TAU_BUFFER_HH
 
+#include <tau/enums.hh>
 #include <tau/types.hh>
 #include <tau/signal.hh>
 #include <tau/ustring.hh>
@@ -278,6 +279,7 @@ public:
 private:
 
     friend class Buffer;
+    friend struct Buffer_impl;
     Buffer_citer(Buffer_citer_impl * p);
     Buffer_citer_impl * impl;
 };
@@ -327,7 +329,9 @@ public:
 
     /// Load from file.
     /// @param path an UTF-8 encoded path to the file.
-    static Buffer load_from_file(const ustring & path);
+    /// @param flags loading flags, see #Buffer_flags enum.
+    /// @throw sys_error if file can not be opened or mapped.
+    static Buffer load_from_file(const ustring & path, int flags=BUFFER_DEFAULT);
 
     /// Save to stream.
     void save(std::ostream & os);
@@ -464,6 +468,11 @@ public:
     /// Enables buffer modifying.
     void unlock();
 
+    /// Test if buffer loaded with #BUFFER_MAPPED flag is still being indexed.
+    /// @sa signal_progress()
+    /// @since 0.4.0
+    bool indexing() const;
+
     /// @name Signals
     /// @{
 
@@ -533,6 +542,18 @@ public:
     /// @sa bom_enabled()
     signal<void()> & signal_bom_changed();
 
+    /// Signal emitted while buffer loaded with #BUFFER_MAPPED flag being indexed.
+    /// Emitted after new rows become available, the rows are also reported
+    /// by signal_insert(). When indexing finished, indexed byte count equals
+    /// to the total byte count.
+    /// Slot prototype:
+    /// ~~~~~~~~~~~~~~~
+    /// void on_buffer_progress(std::size_t indexed_bytes, std::size_t total_bytes);
+    /// ~~~~~~~~~~~~~~~
+    /// @sa indexing()
+    /// @since 0.4.0
+    signal<void(std::size_t, std::size_t)> & signal_progress();
+
     /// @}
 
 private:
@@ -60,6 +60,8 @@ public:
     Display & operator=(const Display & other) = default;
 
     /// Open display with optional arguments.
+    /// Arguments are space separated words. Currently recognized:
+    /// - "noshm": on X11, do not use MIT-SHM extension for image transfer.
     static Display open(const ustring & args=ustring());
 
     /// Gets unique id.
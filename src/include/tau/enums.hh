@@ -454,6 +454,28 @@ enum Action_items {
     ACTION_NO_ICON = (ACTION_ALL & ~ACTION_ICON)
 };
 
+/// Buffer loading flags.
+/// @ingroup enum_group
+/// @since 0.4.0
+enum Buffer_flags {
+
+    /// Default storage, text decoded into UTF-32 rows.
+    BUFFER_DEFAULT  = 0,
+
+    /// Compact storage, UTF-8 or 8-bit text kept as loaded and decoded on access.
+    /// The buffer switches to default storage on first modification.
+    BUFFER_COMPACT  = 1 << 0,
+
+    /// Read-only storage, the file is mapped into memory and read from the mapping.
+    /// Rows are indexed by background thread and become available while indexing
+    /// proceeds, see Buffer::signal_progress(). The buffer is locked.
+    /// Requires running event loop.
+    /// @warning The file must not be truncated while the buffer exists, e.g. by
+    /// log rotation using copytruncate: reading beyond the new end of file
+    /// raises SIGBUS.
+    BUFFER_MAPPED   = 1 << 1
+};
+
 } // namespace tau
 
 #endif // TAU_ENUMS_HH
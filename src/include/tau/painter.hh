@@ -32,6 +32,7 @@
 #include <tau/types.hh>
 #include <tau/enums.hh>
 #include <tau/ustring.hh>
+#include <vector>
 
 namespace tau {
 
@@ -95,6 +96,17 @@ public:
     /// @note Check %Painter is not pure before using it!
     Vector text_size(const std::u32string & s, Orientation orient=ORIENTATION_RIGHT);
 
+    /// Get text size and advances of every character.
+    /// Measures text in a single pass, suitable for long strings.
+    /// @param s an UTF-32 string.
+    /// @param advances receives cumulative advances: i-th element holds text width
+    ///        from the beginning up to the end of i-th character, resized to s.size().
+    /// @param orient text orientation (reserved, but not yet implemented).
+    /// @return zeroed vector on empty %Painter or text size in pixels.
+    /// @note This method does not work on pure %Painter.
+    /// @since 0.4.0
+    Vector text_size(const std::u32string & s, std::vector<int> & advances, Orientation orient=ORIENTATION_RIGHT);
+
     /// Draw text at current position.
     /// @param s text to be drawn.
     /// @param c color that will be used.
@@ -1237,6 +1237,34 @@ public:
     /// @sa Window::update()
     void invalidate(const Rect & r=Rect());
 
+    /// Enable retained painting.
+    ///
+    /// Drawing made by signal_backpaint() and signal_paint() handlers is recorded when the
+    /// entire visible area of the widget painted at once. Subsequent repaints replay the record
+    /// instead of signal emission until invalidate() called or widget size or scroll position changed.
+    /// Useful for complex widgets whose look rarely changes, like frames, headers or icon grids.
+    /// Drawing made using painter() is not recorded.
+    ///
+    /// @sa disable_retained_paint()
+    /// @sa retained_paint_enabled()
+    /// @note disabled by default.
+    /// @since 0.4.0
+    void enable_retained_paint();
+
+    /// Disable retained painting.
+    /// @sa enable_retained_paint()
+    /// @sa retained_paint_enabled()
+    /// @note disabled by default.
+    /// @since 0.4.0
+    void disable_retained_paint();
+
+    /// Test if retained painting enabled.
+    /// @sa enable_retained_paint()
+    /// @sa disable_retained_paint()
+    /// @note disabled by default.
+    /// @since 0.4.0
+    bool retained_paint_enabled() const;
+
     /// @}
     /// @name Keyboard
     /// @{
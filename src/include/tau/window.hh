@@ -30,9 +30,33 @@
 #define TAU_WINDOW_HH
 
 #include <tau/bin.hh>
+#include <string>
+#include <vector>
 
 namespace tau {
 
+/// Paint statistics of a single widget collected during one frame.
+/// Widget painted within both background and foreground passes
+/// has two records within the frame.
+/// @see Window::enable_paint_profile
+/// @since 0.4.0
+/// @ingroup window_group
+struct Paint_profile {
+    std::string     widget;             ///< Class name of the widget implementation.
+    int             depth = 0;          ///< Nesting depth, the window itself has depth 0.
+    int             parent = -1;        ///< Index of the parent's record or -1 for the window.
+    bool            backpaint = false;  ///< Record belongs to background paint pass.
+    uint64_t        total_us = 0;       ///< Time spent by widget and its children, in microseconds.
+    uint64_t        self_us = 0;        ///< Time spent by widget itself, in microseconds.
+    unsigned        contours = 0;       ///< Number of contours painted.
+    unsigned        rects = 0;          ///< Number of rectangles painted.
+    unsigned        arcs = 0;           ///< Number of arcs and circles painted.
+    unsigned        texts = 0;          ///< Number of text strings painted.
+    unsigned        pixmaps = 0;        ///< Number of pixmaps painted.
+    uint64_t        pixels = 0;         ///< Pixels covered by primitive bounds, clipped to visible area.
+    unsigned        requests = 0;       ///< Requests issued to the display server.
+};
+
 /// An abstract base class for all windows.
 ///
 /// @note This class is a wrapper around its implementation shared pointer.
@@ -78,6 +102,63 @@ public:
     /// Flush any pending paint and resize requests.
     void update();
 
+    /// Enable double buffered repaint.
+    /// The invalidated area is painted into an off-screen buffer first
+    /// and then copied onto the window at once, so overlapping widgets
+    /// do not flicker during repaint. The buffer is a window sized
+    /// pixmap held by the display server.
+    /// At the moment, has an effect on X11 only.
+    /// @see disable_double_buffer
+    /// @see double_buffer_enabled
+    /// @note disabled by default.
+    /// @since 0.4.0
+    void enable_double_buffer();
+
+    /// Disable double buffered repaint.
+    /// @see enable_double_buffer
+    /// @see double_buffer_enabled
+    /// @note disabled by default.
+    /// @since 0.4.0
+    void disable_double_buffer();
+
+    /// Test if double buffered repaint enabled.
+    /// @see enable_double_buffer
+    /// @see disable_double_buffer
+    /// @note disabled by default.
+    /// @since 0.4.0
+    bool double_buffer_enabled() const;
+
+    /// Enable paint profiling.
+    /// While enabled, the window collects per widget statistics for every
+    /// painted frame: time spent, primitive counts, pixels painted and
+    /// display server requests issued.
+    /// Setting TAU_PAINT_PROFILE environment variable enables profiling for
+    /// all windows and writes every frame as a line of JSON into the file named
+    /// by the variable value, or into standard error output if value is "-".
+    /// @see disable_paint_profile
+    /// @see paint_profile_enabled
+    /// @see paint_profile
+    /// @note disabled by default.
+    /// @since 0.4.0
+    void enable_paint_profile();
+
+    /// Disable paint profiling.
+    /// @see enable_paint_profile
+    /// @since 0.4.0
+    void disable_paint_profile();
+
+    /// Test if paint profiling enabled.
+    /// @see enable_paint_profile
+    /// @since 0.4.0
+    bool paint_profile_enabled() const;
+
+    /// Get statistics of the last painted frame.
+    /// Records are ordered by paint order, parent before its children.
+    /// @return empty vector if paint profiling is disabled or no frame painted yet.
+    /// @see enable_paint_profile
+    /// @since 0.4.0
+    std::vector<Paint_profile> paint_profile() const;
+
     /// Signal emitted when window moves across it's parent or screen.
     /// Slot prototype:
     /// ~~~~~~~~~~~~~~~
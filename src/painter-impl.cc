@@ -27,9 +27,13 @@
 #include <tau/exception.hh>
 #include <brush-impl.hh>
 #include <container-impl.hh>
+#include <font-impl.hh>
 #include <glyph-impl.hh>
 #include <painter-impl.hh>
+#include <pen-impl.hh>
 #include <pixmap-impl.hh>
+#include <algorithm>
+#include <cmath>
 #include <climits>
 #include <iostream>
 
@@ -61,6 +65,11 @@ int ifrac(int64_t x) {
     return x & 65535;
 }
 
+// Convert 16.16 fixed point coverage into 8 bit alpha.
+uint8_t coverage(int64_t c) {
+    return c <= 0 ? 0 : (c >= 65536 ? 255 : (255*c+32768) >> 16);
+}
+
 bool is_top_overshoot(int64_t x) {
     return x-ifloor(x) >= 32768;
 }
@@ -135,6 +144,93 @@ double transformed_circle_major_axis(const tau::Matrix & mat, double radius) {
     return radius*std::sqrt(f+std::hypot(g, h));
 }
 
+using Polygon = std::vector<tau::Vector>;
+
+double cross(const tau::Vector & a, const tau::Vector & b) {
+    return a.x()*b.y()-a.y()*b.x();
+}
+
+// Appends polygon to the outline. All pieces get the same orientation,
+// so the rasterizer unites overlapping ones.
+void add_piece(std::vector<tau::Contour> & ctrs, Polygon & pg) {
+    std::size_t n = pg.size();
+    if (n < 3) { return; }
+    double area = 0.0;
+    for (std::size_t i = 0; i < n; ++i) { area += cross(pg[i], pg[(i+1) % n]); }
+    if (std::fabs(area) < tolerance_) { return; }
+    if (area < 0.0) { std::reverse(pg.begin(), pg.end()); }
+    tau::Contour ctr(pg[0]);
+    for (std::size_t i = 1; i < n; ++i) { ctr.line_to(pg[i]); }
+    ctrs.emplace_back(std::move(ctr));
+}
+
+void add_disc(std::vector<tau::Contour> & ctrs, const tau::Vector & c, double r) {
+    int n = std::max(8, std::min(64, int(2*PI*r/2)));
+    Polygon pg;
+    pg.reserve(n);
+    for (int i = 0; i < n; ++i) { pg.emplace_back(c.x()+r*std::cos(2*PI*i/n), c.y()+r*std::sin(2*PI*i/n)); }
+    add_piece(ctrs, pg);
+}
+
+// Outline of the open or closed polyline having no dashes, w is half width.
+void outline_run(std::vector<tau::Contour> & ctrs, const Polygon & v, double w, const tau::Pen_impl & pen) {
+    std::size_t n = v.size();
+    if (n < 2) { return; }
+    bool closed = n > 2 && (v.front()-v.back()).length() < tolerance_;
+    Polygon pg;
+
+    for (std::size_t i = 0; i+1 < n; ++i) {
+        tau::Vector a = v[i], b = v[i+1], d = b-a;
+        double len = d.length();
+        if (len < tolerance_) { continue; }
+        d = d/len;
+        tau::Vector nv(-d.y()*w, d.x()*w);
+
+        if (!closed && tau::SQUARE_CAP == pen.cap_style) {
+            if (0 == i) { a = a-d*w; }
+            if (i+2 == n) { b = b+d*w; }
+        }
+
+        pg = { a+nv, b+nv, b-nv, a-nv };
+        add_piece(ctrs, pg);
+    }
+
+    if (!closed && tau::ROUND_CAP == pen.cap_style) {
+        add_disc(ctrs, v.front(), w);
+        add_disc(ctrs, v.back(), w);
+    }
+
+    // Joins.
+    for (std::size_t i = closed ? 0 : 1; i+1 < n; ++i) {
+        const tau::Vector & p = v[i];
+        tau::Vector d1 = p-v[0 == i ? n-2 : i-1], d2 = v[i+1]-p;
+        double l1 = d1.length(), l2 = d2.length();
+        if (l1 < tolerance_ || l2 < tolerance_) { continue; }
+
+        if (tau::ROUND_JOIN == pen.join_style) {
+            add_disc(ctrs, p, w);
+            continue;
+        }
+
+        d1 = d1/l1, d2 = d2/l2;
+        double s = cross(d1, d2) > 0.0 ? -w : w;
+        tau::Vector n1(-d1.y()*s, d1.x()*s), n2(-d2.y()*s, d2.x()*s);
+        pg = { p, p+n1, p+n2 };
+
+        if (tau::MITER_JOIN == pen.join_style) {
+            tau::Vector m = n1+n2;
+            double ml = m.length(), cosh = ml/(2*w);
+
+            // Miter length to line width ratio is 1/cos(half of the angle between normals).
+            if (cosh > tolerance_ && 1.0/cosh <= pen.miter_limit) {
+                pg = { p, p+n1, p+m*(w/(ml*cosh)), p+n2 };
+            }
+        }
+
+        add_piece(ctrs, pg);
+    }
+}
+
 } // anonymous namespace
 
 // ----------------------------------------------------------------------------
@@ -156,6 +252,20 @@ void Painter_impl::reserve_stack(std::size_t n) {
     stack_.reserve(n+n);
 }
 
+void Painter_impl::set_damage(const Region & damage) {
+    damage_ = damage;
+    damaged_ = true;
+    update_clip();
+}
+
+void Painter_impl::reset_damage() {
+    if (damaged_) {
+        damage_.clear();
+        damaged_ = false;
+        update_clip();
+    }
+}
+
 void Painter_impl::wreset() {
     clear();
     stack_.clear();
@@ -237,6 +347,26 @@ void Painter_impl::text(std::u32string && str, const Color & c) {
     prims_.push_back(new_prim_text(position(), std::move(str), c));
 }
 
+// public
+Vector Painter_impl::text_size(const std::u32string & s, int * advances) {
+    int w = 0, h = 0;
+
+    if (Font_ptr fp = font()) {
+        h = std::ceil(fp->ascent()-fp->descent()+fp->linegap());
+
+        for (char32_t wc: s) {
+            w += fp->advance(wc);
+            if (advances) { *advances++ = w; }
+        }
+    }
+
+    else if (advances) {
+        std::fill(advances, advances+s.size(), 0);
+    }
+
+    return Vector(w, h);
+}
+
 // public
 void Painter_impl::pixmap(Pixmap_cptr pix, const Point pix_origin, const Size & pix_size, bool transparent) {
     flush_object();
@@ -318,56 +448,22 @@ void Painter_impl::contour(Contour && ctr) {
 }
 
 // public
-// Overriden by Pixmap_painter.
 void Painter_impl::paint() {
+    if (rec_) { record(OP_PAINT); }
+
     if (visible()) {
         fill_rectangles(&wstate().obscured_, 1, state().brush_->color);
+        commit();
     }
 }
 
 void Painter_impl::stroke_preserve() {
     flush_object();
+    if (rec_) { record(OP_STROKE); }
 
     if (visible()) {
-        Prim ** pp = prims_.data(), **pe = prims_.data()+prims_.size();
-
-        while (pp != pe) {
-            if (auto * p_ctr = dynamic_cast<Prim_contour *>(*pp)) {
-                for (auto & ctr: p_ctr->ctrs) { stroke_contour(ctr); }
-                ++pp;
-            }
-
-            else if (auto * p_rect = dynamic_cast<Prim_rect *>(*pp)) {
-                auto q = p_rect;
-                std::size_t n = 1;
-
-                while (++pp != pe) {
-                    if (!dynamic_cast<Prim_rect *>(*pp)) { break; }
-                    ++n;
-                }
-
-                stroke_prim_rect(q, n);
-            }
-
-            else if (auto * p_arc = dynamic_cast<Prim_arc *>(*pp)) {
-                stroke_prim_arc(*p_arc);
-                ++pp;
-            }
-
-            else if (auto * p_text = dynamic_cast<Prim_text *>(*pp)) {
-                stroke_prim_text(*p_text);
-                ++pp;
-            }
-
-            else if (auto * p_pix = dynamic_cast<Prim_pixmap *>(*pp)) {
-                draw_pixmap(p_pix->pix, p_pix->origin, p_pix->size, Point(matrix()*p_pix->pos)-woffset(), p_pix->transparent);
-                ++pp;
-            }
-
-            else {
-                ++pp;
-            }
-        }
+        execute(prims_.data(), prims_.data()+prims_.size(), false);
+        commit();
     }
 }
 
@@ -380,54 +476,134 @@ void Painter_impl::stroke() {
 // public
 void Painter_impl::fill_preserve() {
     flush_object();
+    if (rec_) { record(OP_FILL); }
 
     if (visible()) {
-        Prim ** pp = prims_.data(), **pe = prims_.data()+prims_.size();
+        execute(prims_.data(), prims_.data()+prims_.size(), true);
+        commit();
+    }
+}
 
-        while (pp != pe) {
-            if (auto * p_ctr = dynamic_cast<Prim_contour *>(*pp)) {
-                fill_prim_contour(*p_ctr);
-                ++pp;
-            }
+// public
+void Painter_impl::fill() {
+    fill_preserve();
+    clear();
+}
 
-            else if (auto * p_rect = dynamic_cast<Prim_rect *>(*pp)) {
-                auto q = p_rect;
-                std::size_t n = 1;
+// private
+// Adjacent rectangles are passed by a single call when they are stored contiguously.
+void Painter_impl::execute(Prim ** pp, Prim ** pe, bool fill) {
+    if (prof_) { profile(pp, pe); }
+
+    while (pp != pe) {
+        if (auto * p_ctr = dynamic_cast<Prim_contour *>(*pp)) {
+            if (fill) { fill_prim_contour(*p_ctr); }
+            else { for (auto & ctr: p_ctr->ctrs) { stroke_contour(ctr); } }
+            ++pp;
+        }
 
-                while (++pp != pe) {
-                    if (!dynamic_cast<Prim_rect *>(*pp)) { break; }
-                    ++n;
-                }
+        else if (auto * p_rect = dynamic_cast<Prim_rect *>(*pp)) {
+            auto q = p_rect;
+            std::size_t n = 1;
 
-                fill_prim_rect(q, n);
+            while (++pp != pe) {
+                if (q+n != *pp || !dynamic_cast<Prim_rect *>(*pp)) { break; }
+                ++n;
             }
 
-            else if (auto * p_arc = dynamic_cast<Prim_arc *>(*pp)) {
-                fill_prim_arc(*p_arc);
-                ++pp;
-            }
+            if (fill) { fill_prim_rect(q, n); }
+            else { stroke_prim_rect(q, n); }
+        }
 
-            else if (auto * p_text = dynamic_cast<Prim_text *>(*pp)) {
-                stroke_prim_text(*p_text);
-                ++pp;
-            }
+        else if (auto * p_arc = dynamic_cast<Prim_arc *>(*pp)) {
+            if (fill) { fill_prim_arc(*p_arc); }
+            else { stroke_prim_arc(*p_arc); }
+            ++pp;
+        }
 
-            else if (auto * p_pix = dynamic_cast<Prim_pixmap *>(*pp)) {
-                draw_pixmap(p_pix->pix, p_pix->origin, p_pix->size, Point(matrix()*p_pix->pos)-woffset(), p_pix->transparent);
-                ++pp;
-            }
+        else if (auto * p_text = dynamic_cast<Prim_text *>(*pp)) {
+            stroke_prim_text(*p_text);
+            ++pp;
+        }
 
-            else {
-                ++pp;
-            }
+        else if (auto * p_pix = dynamic_cast<Prim_pixmap *>(*pp)) {
+            draw_pixmap(p_pix->pix, p_pix->origin, p_pix->size, Point(matrix()*p_pix->pos)-woffset(), p_pix->transparent);
+            ++pp;
+        }
+
+        else {
+            ++pp;
         }
     }
 }
 
-// public
-void Painter_impl::fill() {
-    fill_preserve();
-    clear();
+// private
+// Counts primitives and pixels within their bounds, clipped to visible area.
+void Painter_impl::profile(Prim ** pp, Prim ** pe) {
+    Paint_profile * rec = prof_->current();
+    if (!rec) { return; }
+    std::vector<Vector> vs;
+
+    for (; pp != pe; ++pp) {
+        vs.clear();
+
+        if (auto * p_ctr = dynamic_cast<Prim_contour *>(*pp)) {
+            ++rec->contours;
+
+            for (auto & ctr: p_ctr->ctrs) {
+                vs.push_back(ctr.start());
+
+                for (const Curve & cv: ctr) {
+                    vs.push_back(cv.end());
+                    if (cv.order() > 1) { vs.push_back(cv.cp1()); }
+                    if (cv.order() > 2) { vs.push_back(cv.cp2()); }
+                }
+            }
+        }
+
+        else if (auto * p_rect = dynamic_cast<Prim_rect *>(*pp)) {
+            ++rec->rects;
+            vs.push_back(p_rect->v1);
+            vs.push_back(p_rect->v2);
+            vs.emplace_back(p_rect->v1.x(), p_rect->v2.y());
+            vs.emplace_back(p_rect->v2.x(), p_rect->v1.y());
+        }
+
+        else if (auto * p_arc = dynamic_cast<Prim_arc *>(*pp)) {
+            ++rec->arcs;
+            Vector d(p_arc->radius, p_arc->radius);
+            vs.push_back(p_arc->center-d);
+            vs.push_back(p_arc->center+d);
+            vs.push_back(p_arc->center+Vector(d.x(), -d.y()));
+            vs.push_back(p_arc->center+Vector(-d.x(), d.y()));
+        }
+
+        else if (auto * p_text = dynamic_cast<Prim_text *>(*pp)) {
+            ++rec->texts;
+            vs.push_back(p_text->pos);
+            vs.push_back(p_text->pos+text_size(p_text->str));
+        }
+
+        else if (auto * p_pix = dynamic_cast<Prim_pixmap *>(*pp)) {
+            ++rec->pixmaps;
+            vs.push_back(p_pix->pos);
+            vs.push_back(p_pix->pos+Vector(p_pix->size.width(), p_pix->size.height()));
+        }
+
+        if (!vs.empty()) {
+            double x1 = INT_MAX, y1 = INT_MAX, x2 = INT_MIN, y2 = INT_MIN;
+
+            for (Vector v: vs) {
+                v = matrix()*v;
+                x1 = std::min(x1, v.x()); y1 = std::min(y1, v.y());
+                x2 = std::max(x2, v.x()); y2 = std::max(y2, v.y());
+            }
+
+            Point org = Point(int(std::floor(x1)), int(std::floor(y1)))-woffset();
+            Rect r = Rect(org, Size(unsigned(std::ceil(x2-x1)), unsigned(std::ceil(y2-y1)))) & wstate().obscured_;
+            rec->pixels += uint64_t(r.width())*r.height();
+        }
+    }
 }
 
 // protected
@@ -468,7 +644,7 @@ void Painter_impl::stroke_contour(const Contour & ctr) {
                 Point pts[2];
                 pts[0] = start;
                 pts[1] = cv.end();
-                stroke_polyline(pts, 1);
+                stroke_polyline(pts, 2);
             }
 
             start = cv.end();
@@ -476,6 +652,68 @@ void Painter_impl::stroke_contour(const Contour & ctr) {
     }
 }
 
+// protected
+// Builds outline of the polyline given in device coordinates using current pen,
+// points are pixel centers. The outline is suitable for raster_contours().
+void Painter_impl::stroke_outline(const Point * pts, std::size_t npts, std::vector<Contour> & ctrs) {
+    const Pen_impl & pen = *state().pen_;
+    double lw = std::max(1.0, pen.line_width), w = 0.5*lw;
+    Polygon v;
+    v.reserve(npts);
+    for (std::size_t i = 0; i < npts; ++i) { v.emplace_back(pts[i].x()+0.5, pts[i].y()+0.5); }
+
+    std::vector<double> dashes;
+
+    switch (pen.line_style) {
+        case DASH_LINE: dashes = { 4, 4 }; break;
+        case DOT_LINE: dashes = { 1, 2 }; break;
+        case DASH_DOT_LINE: dashes = { 4, 2, 1, 2 }; break;
+        case DASH_DOT_DOT_LINE: dashes = { 4, 2, 1, 2, 1, 2 }; break;
+        case CUSTOM_DASH_LINE: dashes = pen.dashes; break;
+        default: ;
+    }
+
+    double period = 0.0;
+    for (double & d: dashes) { d = std::max(0.0, d*lw); period += d; }
+
+    if (period < 1.0) {
+        outline_run(ctrs, v, w, pen);
+        return;
+    }
+
+    // Split into dashes, every dash outlined as an open polyline.
+    std::size_t di = 0;
+    double left = std::fmod(pen.dash_offset*lw, period);
+
+    while (left >= dashes[di]) { left -= dashes[di]; di = (di+1) % dashes.size(); }
+    left = dashes[di]-left;
+    Polygon run;
+    if (0 == di % 2) { run.push_back(v[0]); }
+
+    for (std::size_t i = 0; i+1 < v.size(); ++i) {
+        Vector a = v[i], d = v[i+1]-a;
+        double len = d.length(), pos = 0.0;
+        if (len < tolerance_) { continue; }
+        d = d/len;
+
+        while (len-pos > left) {
+            pos += left;
+            Vector p = a+d*pos;
+
+            if (0 == di % 2) { run.push_back(p); outline_run(ctrs, run, w, pen); run.clear(); }
+            else { run.push_back(p); }
+
+            di = (di+1) % dashes.size();
+            left = dashes[di];
+        }
+
+        left -= len-pos;
+        if (0 == di % 2) { run.push_back(v[i+1]); }
+    }
+
+    outline_run(ctrs, run, w, pen);
+}
+
 // protected
 void Painter_impl::stroke_conic(const Vector & start, const Vector & cp, const Vector & end) {
     if (!visible()) { return; }
@@ -684,6 +922,74 @@ void Painter_impl::clear() {
     if (last_) { free_prim(last_); last_ = nullptr; }
 }
 
+// public
+void Painter_impl::begin_record() {
+    rec_ = std::make_shared<Display_list>();
+}
+
+// public
+Display_list_ptr Painter_impl::end_record() {
+    Display_list_ptr dl = rec_;
+    rec_.reset();
+    return dl;
+}
+
+// public
+// Current path is dropped.
+void Painter_impl::replay(const Display_list & dl) {
+    for (auto & op: dl.ops) {
+        clear();
+        push();
+        state() = op.state;
+
+        if (OP_PAINT == op.op) {
+            paint();
+        }
+
+        else {
+            for (Prim * p: op.prims) { ++p->ref; prims_.push_back(p); }
+            if (OP_FILL == op.op) { fill(); }
+            else { stroke(); }
+        }
+
+        pop();
+    }
+}
+
+// private
+// Brush and pen copied because those may be changed after recording.
+void Painter_impl::record(int op) {
+    rec_->ops.emplace_back();
+    auto & o = rec_->ops.back();
+    o.op = op;
+    o.state = state();
+    if (o.state.brush_) { o.state.brush_ = std::make_shared<Brush_impl>(*o.state.brush_); }
+    if (o.state.pen_) { o.state.pen_ = std::make_shared<Pen_impl>(*o.state.pen_); }
+
+    if (OP_PAINT != op) {
+        o.prims.reserve(prims_.size());
+        for (const Prim * p: prims_) { if (Prim * q = copy_prim(p)) { o.prims.push_back(q); } }
+    }
+}
+
+// private
+Painter_impl::Prim * Painter_impl::copy_prim(const Prim * p) {
+    Prim * q = nullptr;
+
+    if (auto * pc = dynamic_cast<const Prim_contour *>(p)) { q = new Prim_contour(*pc); }
+    else if (auto * pr = dynamic_cast<const Prim_rect *>(p)) { q = new Prim_rect(*pr); }
+    else if (auto * pa = dynamic_cast<const Prim_arc *>(p)) { q = new Prim_arc(*pa); }
+    else if (auto * pt = dynamic_cast<const Prim_text *>(p)) { q = new Prim_text(*pt); }
+    else if (auto * pp = dynamic_cast<const Prim_pixmap *>(p)) { q = new Prim_pixmap(*pp); }
+
+    if (q) {
+        q->heap = true;
+        q->ref = 1;
+    }
+
+    return q;
+}
+
 // private
 void Painter_impl::flush_object() {
     if (last_) {
@@ -1182,19 +1488,20 @@ void Painter_impl::sort_raster_profiles(Raster & ras, RP_list & v) {
         else  { prof->ix_--; }
     }
 
-    v.sort([](Raster_profile * i, Raster_profile * j) { return i->x_ > j->x_; });
+    // Insertion sort: the order changes a little from one scanline to the next.
+    for (std::size_t i = 1; i < v.size(); ++i) {
+        Raster_profile * prof = v[i];
+        std::size_t j = i;
+        for (; j && v[j-1]->x_ < prof->x_; --j) { v[j] = v[j-1]; }
+        v[j] = prof;
+    }
 }
 
 // private
 void Painter_impl::raster_sweep(Raster & ras, bool vert) {
-    constexpr double mul = 1.0/65536;
-    double fade;
-#if TAU_HAS_VALLOCATOR
-    v_allocator<Raster_profile *> alloc;
-    RP_list dl(alloc), dr(alloc);
-#else
-    RP_list dl, dr;
-#endif
+    RP_list & dl = ras.dl_, & dr = ras.dr_;
+    dl.clear();
+    dr.clear();
 
     // first, compute min and max Y
     int ymin = INT_MAX, ymax = INT_MIN;
@@ -1219,8 +1526,8 @@ void Painter_impl::raster_sweep(Raster & ras, bool vert) {
     // let's go
     int y = ymin, y_height = 0;
 
-    ras.turns_.sort();
-    ras.turns_.unique();
+    std::sort(ras.turns_.begin(), ras.turns_.end());
+    ras.turns_.erase(std::unique(ras.turns_.begin(), ras.turns_.end()), ras.turns_.end());
 
     for (int y_change: ras.turns_) {
         if (y_change != ymin) {
@@ -1229,8 +1536,8 @@ void Painter_impl::raster_sweep(Raster & ras, bool vert) {
                     prof.count_ -= y_height;
 
                     if (0 == prof.count_) {
-                        if (prof.ascend_) { dl.push_front(&prof); }
-                        else { dr.push_front(&prof); }
+                        if (prof.ascend_) { dl.push_back(&prof); }
+                        else { dr.push_back(&prof); }
                     }
                 }
             }
@@ -1252,31 +1559,25 @@ void Painter_impl::raster_sweep(Raster & ras, bool vert) {
 
                     if (vert) {
                         if (0 == d) {
-                            fade = mul*(ifrac(x1-x2));
-                            raster_fill_rectangle(ras, y, e1, y, e1, ras.color_.darken(fade));
+                            raster_vspan(ras, y, e1, e1, coverage(65536-ifrac(x1-x2)));
                         }
 
                         else {
-                            if (d > 1) { raster_fill_rectangle(ras, y, e1+1, y, e2-1, ras.color_); }
-                            fade = mul*(ifrac(x1));
-                            raster_fill_rectangle(ras, y, e1, y, e1, ras.color_.darken(fade));
-                            fade = mul*(65536-ifrac(x2));
-                            raster_fill_rectangle(ras, y, e2, y, e2, ras.color_.darken(fade));
+                            if (d > 1) { raster_vspan(ras, y, e1+1, e2-1, 255); }
+                            raster_vspan(ras, y, e1, e1, coverage(65536-ifrac(x1)));
+                            raster_vspan(ras, y, e2, e2, coverage(ifrac(x2)));
                         }
                     }
 
                     else {
                         if (0 == d) {
-                            fade = mul*(ifrac(x1-x2));
-                            raster_fill_rectangle(ras, e1, y, e1, y, ras.color_.darken(fade));
+                            raster_hspan(ras, e1, e1, y, coverage(65536-ifrac(x1-x2)));
                         }
 
                         else {
-                            if (d > 1) { raster_fill_rectangle(ras, e1+1, y, e2-1, y, ras.color_); }
-                            fade = mul*(ifrac(x1));
-                            raster_fill_rectangle(ras, e1, y, e1, y, ras.color_.darken(fade));
-                            fade = mul*(65536-ifrac(x2));
-                            raster_fill_rectangle(ras, e2, y, e2, y, ras.color_.darken(fade));
+                            if (d > 1) { raster_hspan(ras, e1+1, e2-1, y, 255); }
+                            raster_hspan(ras, e1, e1, y, coverage(65536-ifrac(x1)));
+                            raster_hspan(ras, e2, e2, y, coverage(ifrac(x2)));
                         }
                     }
                 }
@@ -1287,12 +1588,9 @@ void Painter_impl::raster_sweep(Raster & ras, bool vert) {
                 }
             }
 
-            for (auto & prof: ras.pros_) {
-                if (0 == prof.height_) {
-                    dl.remove(&prof);
-                    dr.remove(&prof);
-                }
-            }
+            auto done = [](Raster_profile * prof) { return 0 == prof->height_; };
+            dl.erase(std::remove_if(dl.begin(), dl.end(), done), dl.end());
+            dr.erase(std::remove_if(dr.begin(), dr.end(), done), dr.end());
         }
     }
 }
@@ -1352,8 +1650,8 @@ void Painter_impl::raster_pass(Raster & ras, const Contour * ctrs, std::size_t n
             p.ix_ += p.height_-1;
         }
 
-        ras.turns_.push_front(bottom);
-        ras.turns_.push_front(top+1);
+        ras.turns_.push_back(bottom);
+        ras.turns_.push_back(top+1);
     }
 
     raster_sweep(ras, vert);
@@ -1365,17 +1663,103 @@ void Painter_impl::raster_pass(Raster & ras, const Contour * ctrs, std::size_t n
 }
 
 // private
-void Painter_impl::raster_fill_rectangle(Raster & ras, int x1, int y1, int x2, int y2, const Color & c) {
-    Rect r(x1, y1, x2, y2);
-    r &= wstate().obscured_;
-    if (r) { fill_rectangles(&r, 1, c); }
+// Accumulate coverage along horizontal span, both ends inclusive.
+void Painter_impl::raster_hspan(Raster & ras, int x1, int x2, int y, uint8_t cov) {
+    const Rect & mb = ras.mbounds_;
+    if (0 == cov || y < mb.top() || y > mb.bottom()) { return; }
+    x1 = std::max(x1, mb.left());
+    x2 = std::min(x2, mb.right());
+
+    if (x1 <= x2) {
+        uint8_t * p = ras.mdata_+(y-mb.top())*ras.mstride_+(x1-mb.left());
+        for (; x1 <= x2; ++x1, ++p) { if (*p < cov) { *p = cov; } }
+        ras.touched_ = true;
+    }
+}
+
+// private
+// Accumulate coverage along vertical span, both ends inclusive.
+void Painter_impl::raster_vspan(Raster & ras, int x, int y1, int y2, uint8_t cov) {
+    const Rect & mb = ras.mbounds_;
+    if (0 == cov || x < mb.left() || x > mb.right()) { return; }
+    y1 = std::max(y1, mb.top());
+    y2 = std::min(y2, mb.bottom());
+
+    if (y1 <= y2) {
+        uint8_t * p = ras.mdata_+(y1-mb.top())*ras.mstride_+(x-mb.left());
+        for (; y1 <= y2; ++y1, p += ras.mstride_) { if (*p < cov) { *p = cov; } }
+        ras.touched_ = true;
+    }
 }
 
 // private
+// Bounding box of control points, the curves can not leave it.
+Rect Painter_impl::raster_bounds(const Contour * ctrs, std::size_t nctrs) {
+    constexpr double lim = INT_MAX/4;
+    double xmin = lim, ymin = lim, xmax = -lim, ymax = -lim;
+
+    auto grow = [&](const Vector & v) {
+        xmin = std::min(xmin, v.x()); xmax = std::max(xmax, v.x());
+        ymin = std::min(ymin, v.y()); ymax = std::max(ymax, v.y());
+    };
+
+    for (; nctrs; --nctrs, ++ctrs) {
+        if (!ctrs->empty()) {
+            grow(ctrs->start());
+
+            for (const Curve & cv: *ctrs) {
+                if (cv.order() > 1) { grow(cv.cp1()); }
+                if (cv.order() > 2) { grow(cv.cp2()); }
+                grow(cv.end());
+            }
+        }
+    }
+
+    if (xmin > xmax || ymin > ymax) { return Rect(); }
+    xmin = std::max(-lim, xmin); xmax = std::min(lim, xmax);
+    ymin = std::max(-lim, ymin); ymax = std::min(lim, ymax);
+    return Rect(int(std::floor(xmin))-1, int(std::floor(ymin))-1, int(std::ceil(xmax))+1, int(std::ceil(ymax))+1);
+}
+
+// protected
 void Painter_impl::raster_contours(const Contour * ctrs, std::size_t nctrs, const Color & color) {
-    Raster ras;
-    ras.pros_.reserve(64);
-    ras.color_ = color;
+    Rect bounds = raster_bounds(ctrs, nctrs) & wstate().obscured_;
+    if (!bounds) { return; }
+
+    Raster & ras = ras_;
+    std::size_t stride = (bounds.width()+3) & ~std::size_t(3);
+    ras.mask_.assign(stride*bounds.height(), 0);
+
+    if (raster_mask(ctrs, nctrs, bounds, ras.mask_.data(), stride)) {
+        fill_mask(bounds, ras.mask_.data(), stride, color);
+    }
+
+    // Do not hold memory taken by an occasional huge fill.
+    if (ras.mask_.capacity() > 4194304) { std::vector<uint8_t>().swap(ras.mask_); }
+}
+
+// public
+void Painter_impl::raster_coverage(const Contour * ctrs, std::size_t nctrs, uint8_t * buffer, const Size & size, std::size_t stride) {
+    Rect bounds = raster_bounds(ctrs, nctrs) & Rect(size);
+
+    if (bounds) {
+        raster_mask(ctrs, nctrs, bounds, buffer+bounds.top()*stride+bounds.left(), stride);
+    }
+}
+
+// private
+// Accumulates coverage within bounds into the mask, which is zero filled.
+// Returns true if something was written.
+bool Painter_impl::raster_mask(const Contour * ctrs, std::size_t nctrs, const Rect & bounds, uint8_t * mask, std::size_t stride) {
+    Raster & ras = ras_;
+    ras.pros_.clear();
+    ras.turns_.clear();
+    ras.xs_.clear();
+    ras.fresh_ = ras.touched_ = ras.joint_ = false;
+    ras.rstate_ = 0;
+    ras.mbounds_ = bounds;
+    ras.mstride_ = stride;
+    ras.mdata_ = mask;
 
     try {
         raster_pass(ras, ctrs, nctrs, false);
@@ -1383,6 +1767,49 @@ void Painter_impl::raster_contours(const Contour * ctrs, std::size_t nctrs, cons
     }
 
     catch (exception & x) { std::cerr << "** " << x.what() << std::endl; }
+
+    ras.mdata_ = nullptr;
+    return ras.touched_;
+}
+
+// protected
+// Overriden by Painter_xcb.
+// Overriden by Pixmap_painter_xcb.
+// Fallback for backends without alpha compositing: solid runs go at once,
+// partially covered runs are drawn using darkened color, one call per run.
+void Painter_impl::fill_mask(const Rect & r, const uint8_t * mask, std::size_t stride, const Color & color) {
+    std::vector<Rect> solid;
+    int w = r.iwidth(), h = r.iheight();
+
+    for (int y = 0; y < h; ++y, mask += stride) {
+        for (int x = 0; x < w; ) {
+            int x0 = x;
+            uint8_t cov = mask[x];
+            while (++x < w && cov == mask[x]) {}
+
+            if (255 == cov) {
+                solid.emplace_back(r.left()+x0, r.top()+y, Size(x-x0, 1));
+            }
+
+            else if (0 != cov) {
+                Rect run(r.left()+x0, r.top()+y, Size(x-x0, 1));
+                fill_rectangles(&run, 1, color.darken(1.0-cov/255.0));
+            }
+        }
+    }
+
+    if (!solid.empty()) {
+        fill_rectangles(solid.data(), solid.size(), color);
+    }
+}
+
+// ----------------------------------------------------------------------------
+// ----------------------------------------------------------------------------
+
+Display_list::~Display_list() {
+    for (auto & op: ops) {
+        for (auto * p: op.prims) { delete p; }
+    }
 }
 
 } // namespace tau
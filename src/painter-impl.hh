@@ -33,9 +33,11 @@
 #include <tau/matrix.hh>
 #include <tau/pen.hh>
 #include <tau/signal.hh>
+#include <profiler-impl.hh>
+#include <region-impl.hh>
 #include <sys-impl.hh>
+#include <types-impl.hh>
 #include <array>
-#include <forward_list>
 #include <vector>
 
 namespace tau {
@@ -62,6 +64,37 @@ public:
     void wreset();
     void reserve_stack(std::size_t n);
 
+    // Restricts painting to the damaged region, given in window coordinates.
+    void set_damage(const Region & damage);
+    void reset_damage();
+
+    // Tests if rectangle, given in window coordinates, intersects damaged region.
+    bool damaged(const Rect & r) const { return !damaged_ || damage_.intersects(r); }
+
+    // Starts recording of paint(), fill() and stroke() operations into display list.
+    void begin_record();
+
+    // Stops recording and returns recorded display list.
+    Display_list_ptr end_record();
+
+    // Executes recorded operations using current offset and clip.
+    void replay(const Display_list & dl);
+
+    // Rasterizes contours directly into zero filled A8 coverage buffer,
+    // buffer origin is at contour's (0:0), rows are stride bytes apart.
+    void raster_coverage(const Contour * ctrs, std::size_t nctrs, uint8_t * buffer, const Size & size, std::size_t stride);
+
+    // Paint profiler receiving statistics, nullptr disables profiling.
+    void set_profiler(Paint_profiler * prof) { prof_ = prof; }
+
+    // Called around painting of every widget.
+    void profile_enter(const Widget_impl * wi, bool backpaint) { if (prof_) { prof_->enter(wi, backpaint, requests()); } }
+    void profile_leave() { if (prof_) { prof_->leave(requests()); } }
+
+    // Returns number of requests issued to display server so far.
+    // Overriden by Painter_xcb.
+    virtual uint64_t requests() const { return 0; }
+
     void push();
     void pop();
     void clear();
@@ -74,7 +107,6 @@ public:
     Font_ptr font() { return state().font_; }
     Matrix & matrix() { return state().mat_; }
 
-    // Overriden by Pixmap_painter.
     virtual void paint();
 
     void fill();
@@ -138,6 +170,11 @@ public:
     virtual Vector text_size(const ustring & s) = 0;
     virtual Vector text_size(const std::u32string & s) = 0;
 
+    // Measures text in one pass using font's cached advances.
+    // When advances is not nullptr, it receives cumulative advance
+    // after every character, so it must have room for s.size() values.
+    Vector text_size(const std::u32string & s, int * advances);
+
 protected:
 
     struct Raster_profile {
@@ -151,28 +188,31 @@ protected:
         std::size_t     ix_ = 0;
     };
 
-#if TAU_HAS_VALLOCATOR
-    using Turns = std::forward_list<int, v_allocator<int>>;
-    using RP_list = std::forward_list<Raster_profile *, v_allocator<Raster_profile *>>;
-#else
-    using Turns = std::forward_list<int>;
-    using RP_list = std::forward_list<Raster_profile *>;
-#endif
+    using Turns = std::vector<int>;
+    using RP_list = std::vector<Raster_profile *>;
     using Raster_profiles = std::vector<Raster_profile>;
     using Arcs = std::vector<Point64>;
     using Points = std::vector<int64_t>;
 
+    // Raster workspace, kept by the painter between fills, so its
+    // storage is allocated once and reused by subsequent fills.
     struct Raster {
         int64_t         x_;
         int64_t         y_;
-        Color           color_;
         bool            fresh_ = false;
+        bool            touched_ = false;   // something was written into the mask
         bool            joint_ = false;
         int             rstate_ = 0;
         Turns           turns_;
         Arcs            arc_ { 32 };
         Points          xs_;
         Raster_profiles pros_;
+        RP_list         dl_;                // left edges drawing list
+        RP_list         dr_;                // right edges drawing list
+        Rect            mbounds_;           // mask bounds in device coordinates
+        std::size_t     mstride_ = 0;       // mask bytes per line
+        uint8_t *       mdata_ = nullptr;   // coverage written here, mask_ or caller's buffer
+        std::vector<uint8_t> mask_;         // A8 coverage mask
     };
 
     struct Prim {
@@ -236,6 +276,10 @@ protected:
 
 private:
 
+    friend Display_list;
+
+    enum { OP_PAINT, OP_FILL, OP_STROKE };
+
     using Stack = std::vector<State>;
     using Wstack = std::vector<Wstate>;
     using Prims = std::vector<Prim *>;
@@ -244,6 +288,11 @@ private:
     Wstack      wstack_;
     Prims       prims_;
     Prim *      last_ = nullptr;
+    Region      damage_;
+    bool        damaged_ = false;
+    Raster      ras_;
+    Display_list_ptr rec_;              // Recording display list.
+    Paint_profiler * prof_ = nullptr;
 
     std::array<Prim_contour, 64> contours_;
     std::array<Prim_arc,     16> arcs_;
@@ -275,6 +324,12 @@ protected:
     virtual void fill_polygon(const Point * pts, std::size_t npts, const Color & color) = 0;
     virtual void draw_pixmap(Pixmap_cptr pix, const Point & pix_origin, const Size & pix_size, const Point & pt, bool transparent) = 0;
 
+    // Composite solid color through A8 coverage mask, r is in device coordinates.
+    // Rows are stride bytes apart, stride is always a multiple of 4.
+    // Overriden by Painter_xcb.
+    // Overriden by Pixmap_painter_xcb.
+    virtual void fill_mask(const Rect & r, const uint8_t * mask, std::size_t stride, const Color & color);
+
     // Overriden by Painter_xcb.
     // Overriden by Painter_win.
     virtual void stroke_prim_text(const Prim_text & o);
@@ -294,6 +349,13 @@ protected:
     virtual void stroke_prim_arc(const Prim_arc & o);
     virtual void fill_prim_arc(const Prim_arc & o);
 
+    // Called when fill(), stroke() or paint() done.
+    // Overriden by Painter_xcb.
+    virtual void commit() {}
+
+    // Returns nullptr when painting is not restricted by damaged region.
+    const Region * damage() const { return damaged_ ? &damage_ : nullptr; }
+
     State & state() { return stack_.back(); }
     const State & state() const { return stack_.back(); }
 
@@ -308,6 +370,8 @@ protected:
     Contour contour_from_arc(const Vector & center, double radius, double angle1, double angle2);
 
     void stroke_contour(const Contour & ctr);
+    void stroke_outline(const Point * pts, std::size_t npts, std::vector<Contour> & ctrs);
+    void raster_contours(const Contour * ctrs, std::size_t nctrs, const Color & color);
     void stroke_conic(const Vector & start, const Vector & cp, const Vector & end);
     void stroke_cubic(const Vector & start, const Vector & cp1, const Vector & cp2, const Vector & end);
 
@@ -325,12 +389,34 @@ private:
     void raster_sweep(Raster & ras, bool horz);
     void raster_add_contour(Raster & ras, const Contour & ctr, bool horz);
     void raster_pass(Raster & ras, const Contour * ctrs, std::size_t nctrs, bool horz);
-    void raster_fill_rectangle(Raster & ras, int x1, int y1, int x2, int y2, const Color & c);
-    void raster_contours(const Contour * ctrs, std::size_t nctrs, const Color & color);
+    bool raster_mask(const Contour * ctrs, std::size_t nctrs, const Rect & bounds, uint8_t * mask, std::size_t stride);
+    void raster_hspan(Raster & ras, int x1, int x2, int y, uint8_t cov);
+    void raster_vspan(Raster & ras, int x, int y1, int y2, uint8_t cov);
+    Rect raster_bounds(const Contour * ctrs, std::size_t nctrs);
     // ----- Raster stuff -----
 
     void flush_object();
     Prim_contour * get_contour();
+    void execute(Prim ** pp, Prim ** pe, bool fill);
+    void profile(Prim ** pp, Prim ** pe);
+    void record(int op);
+    Prim * copy_prim(const Prim * p);
+};
+
+// Painting operations recorded by Painter_impl::begin_record() and
+// replayed by Painter_impl::replay().
+struct Display_list {
+    struct Op {
+        int                     op;
+        Painter_impl::State     state;
+        std::vector<Painter_impl::Prim *> prims;
+    };
+
+    std::vector<Op>     ops;
+    Size                size;       // Size of the widget which painted the list.
+    Point               scroll;     // Scroll position of the widget.
+
+   ~Display_list();
 };
 
 } // namespace tau
@@ -116,6 +116,20 @@ Vector Painter::text_size(const std::u32string & s, Orientation orient) {
     }
 }
 
+Vector Painter::text_size(const std::u32string & s, std::vector<int> & advances, Orientation orient) {
+    advances.resize(s.size());
+
+    if (impl) {
+        return impl->text_size(s, advances.data());
+    }
+
+    else {
+        log("text_size");
+        std::fill(advances.begin(), advances.end(), 0);
+        return Vector();
+    }
+}
+
 void Painter::text(const ustring & s, const Color & c, Orientation orient) {
     if (impl) {
         impl->text(s, c);
@@ -0,0 +1,93 @@
+// ----------------------------------------------------------------------------
+// Copyright © 2014-2023 Konstantin Shmelkov <mrcashe@gmail.com>.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+// PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+// OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+// WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+// OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+// EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+// ----------------------------------------------------------------------------
+
+
+#include <posix/font-coverage-posix.hh>
+#include <cstdio>
+#include <cstdlib>
+
+namespace tau {
+
+void Font_coverage::set(char32_t wc) {
+    std::size_t pg = wc >> 8;
+    if (pg >= index_.size()) { index_.resize(1+pg, 0); }
+
+    if (0 == index_[pg]) {
+        pages_.emplace_back();
+        index_[pg] = pages_.size();
+    }
+
+    pages_[index_[pg]-1].set(wc & 0xff);
+}
+
+std::string Font_coverage::str() const {
+    std::string s;
+    char buf[32];
+    char32_t first = 0;
+    bool in = false;
+    char32_t end = 256*index_.size();
+
+    for (char32_t wc = 0; wc <= end; ++wc) {
+        bool t = wc < end && test(wc);
+
+        if (t && !in) {
+            first = wc;
+            in = true;
+        }
+
+        else if (!t && in) {
+            if (first+1 == wc) { std::snprintf(buf, sizeof buf, "%s%x", s.empty() ? "" : ",", unsigned(first)); }
+            else { std::snprintf(buf, sizeof buf, "%s%x-%x", s.empty() ? "" : ",", unsigned(first), unsigned(wc-1)); }
+            s += buf;
+            in = false;
+        }
+    }
+
+    return s;
+}
+
+// static
+Font_coverage_ptr Font_coverage::from_str(const std::string & s) {
+    auto cov = std::make_shared<Font_coverage>();
+    const char * p = s.c_str();
+
+    while (*p) {
+        char * q;
+        unsigned long first = std::strtoul(p, &q, 16), last = first;
+        if (q == p) { break; }
+        p = q;
+        if ('-' == *p) { last = std::strtoul(p+1, &q, 16); p = q; }
+        if (last > 0x10ffff || last < first) { break; }
+        for (unsigned long wc = first; wc <= last; ++wc) { cov->set(wc); }
+        if (',' == *p) { ++p; }
+    }
+
+    return cov;
+}
+
+} // namespace tau
+
+//END
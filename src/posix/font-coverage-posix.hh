@@ -0,0 +1,68 @@
+// ----------------------------------------------------------------------------
+// Copyright © 2014-2023 Konstantin Shmelkov <mrcashe@gmail.com>.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+// PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+// OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+// WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+// OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+// EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+// ----------------------------------------------------------------------------
+
+
+#ifndef TAU_FONT_COVERAGE_POSIX_HH
+#define TAU_FONT_COVERAGE_POSIX_HH
+
+#include "types-posix.hh"
+#include <bitset>
+#include <string>
+#include <vector>
+
+namespace tau {
+
+// Set of characters having glyphs within the font, taken from the font's
+// character map. Characters are kept in 256 bit pages allocated on demand,
+// so test() takes constant time and typical font needs about 1 KiB.
+class Font_coverage {
+public:
+
+    bool test(char32_t wc) const {
+        std::size_t pg = wc >> 8;
+        return pg < index_.size() && 0 != index_[pg] && pages_[index_[pg]-1].test(wc & 0xff);
+    }
+
+    void set(char32_t wc);
+
+    bool empty() const {
+        return pages_.empty();
+    }
+
+    // Text form used by font registry cache: comma separated hexadecimal
+    // character ranges like "20-7e,a0-17f".
+    std::string str() const;
+    static Font_coverage_ptr from_str(const std::string & s);
+
+private:
+
+    std::vector<uint16_t>           index_; // Page number -> 1+page index within pages_, 0 if no page.
+    std::vector<std::bitset<256>>   pages_;
+};
+
+} // namespace tau
+
+#endif // TAU_FONT_COVERAGE_POSIX_HH
@@ -24,6 +24,7 @@
 // EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 // ----------------------------------------------------------------------------
 
+#include <posix/font-coverage-posix.hh>
 #include <posix/font-face-posix.hh>
 #include <posix/font-file-posix.hh>
 
@@ -35,6 +36,16 @@ Font_face::Font_face(Font_file_ptr file, Master_glyph_ptr zero):
 {
 }
 
+Font_face::~Font_face() {
+    {
+        Lock lock(mx_);
+        stop_ = true;
+    }
+
+    wake_.notify_all();
+    if (worker_.joinable()) { worker_.join(); }
+}
+
 void Font_face::set_family(const ustring & family) {
     family_ = family;
 }
@@ -95,54 +106,104 @@ void Font_face::set_caret_slope_run(bool run) {
     caret_slope_run_ = run;
 }
 
-void Font_face::preload(char32_t first, char32_t last) {
-    std::u32string s(last-first+1, U' ');
-    std::size_t i = 0;
-    for (char32_t c = first; c <= last; ++c) { s[i++] = c; }
-    i = 0;
+void Font_face::set_coverage(Font_coverage_cptr cov) {
+    coverage_ = cov;
+}
 
-    for (auto g: file_->glyphs(family_, facename_, s)) {
-        if (g) {
-            glyphs_[s[i++]] = g;
-        }
-    }
+bool Font_face::covers(char32_t wc) const {
+    return !coverage_ || coverage_->test(wc);
 }
 
-Master_glyph_ptr Font_face::glyph(char32_t wc) {
+// Loads glyphs for given characters without holding the mutex,
+// so concurrent glyph() calls are not blocked. Glyphs already
+// present are kept.
+void Font_face::load(const std::u32string & s) {
+    auto gs = file_->glyphs(family_, facename_, s);
     Lock lock(mx_);
 
-    // Preload ASCII glyphs.
-    if (glyphs_.empty()) {
-        preload(0x0020, 0x007e);
+    for (std::size_t i = 0; i < s.size(); ++i) {
+        glyphs_.emplace(s[i], i < gs.size() ? gs[i] : nullptr);
+    }
+}
+
+// Called under lock.
+void Font_face::request_page(unsigned page) {
+    if (!pages_.test(page)) {
+        pages_.set(page);
+        queue_.push_back(page);
+        if (!worker_.joinable()) { worker_ = std::thread(&Font_face::prefetch, this); }
+        else { wake_.notify_one(); }
     }
+}
+
+// Runs in worker thread, waits for queued pages until stopped.
+void Font_face::prefetch() {
+    for (;;) {
+        unsigned page;
+
+        {
+            std::unique_lock<Mutex> lock(mx_);
+            wake_.wait(lock, [this] { return stop_ || !queue_.empty(); });
+            if (stop_) { return; }
+            page = queue_.front();
+            queue_.pop_front();
+        }
+
+        // Load page by small portions, skipping glyphs loaded on demand meanwhile.
+        char32_t first = 0 == page ? 0x00a0 : page << 8, last = first|0x00ff;
+
+        while (first <= last && !stop_) {
+            std::u32string s;
+
+            {
+                Lock lock(mx_);
 
-    // Try to uncache.
-    auto iter = glyphs_.find(wc);
-    if (iter != glyphs_.end()) { return iter->second; }
+                for (; first <= last && s.size() < 32; ++first) {
+                    if (glyphs_.end() == glyphs_.find(first)) {
+                        s += first;
+                    }
+                }
+            }
+
+            if (!s.empty()) {
+                try { load(s); }
+                catch (...) { break; }
+            }
+        }
+    }
+}
 
-    // Test if it needed to preload Latin1 extended page.
-    if (wc >= 0x00a0 && wc <= 0x00ff && !xlatin_) {
-        preload(0x00a0, 0x00ff);
-        xlatin_ = true;
+Master_glyph_ptr Font_face::glyph(char32_t wc) {
+    // Preload ASCII glyphs once, concurrent callers load on demand meanwhile.
+    if (!ascii_.exchange(true)) {
+        std::u32string s;
+        for (char32_t c = 0x0020; c <= 0x007e; ++c) { s += c; }
+        load(s);
     }
 
-    // Test if it needed to preload Unicode pages 01...ff.
-    if (wc >= 0x0100 && wc <= 0xffff) {
-        if (std::string::npos == preloaded_.find_first_of(wc>>8)) {
-            preloaded_ += (wc>>8);
-            preload(wc&0xff00, wc|0x00ff);
+    {
+        Lock lock(mx_);
+
+        // Try to uncache.
+        auto iter = glyphs_.find(wc);
+        if (iter != glyphs_.end()) { return iter->second ? iter->second : zero_; }
+
+        // Schedule loading of the rest of Unicode page, Latin1 page
+        // is preloaded beginning from U+00A0.
+        if (wc >= 0x00a0 && wc <= 0xffff) {
+            request_page(wc >> 8);
         }
     }
 
     // Not found, load glyph from file.
     auto glyph = file_->glyph(family_, facename_, wc);
 
-    // Return fallback glyph.
-    if (!glyph) { return zero_; }
+    // Cache it, the worker could load it meanwhile.
+    Lock lock(mx_);
+    auto & g = glyphs_.emplace(wc, glyph).first->second;
 
-    // Cache it.
-    glyphs_[wc] = glyph;
-    return glyph;
+    // Return fallback glyph.
+    return g ? g : zero_;
 }
 
 } // namespace tau
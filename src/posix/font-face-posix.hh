@@ -31,8 +31,13 @@
 #include <tau/contour.hh>
 #include <tau/font.hh>
 #include <glyph-impl.hh>
+#include <atomic>
+#include <bitset>
+#include <condition_variable>
+#include <deque>
 #include <mutex>
 #include <map>
+#include <thread>
 
 namespace tau {
 
@@ -129,7 +134,7 @@ public:
     Font_face(Font_face && other) = delete;
     Font_face & operator=(const Font_face & other) = delete;
     Font_face & operator=(Font_face && other) = delete;
-   ~Font_face() {}
+   ~Font_face();
 
     Font_file_ptr font_file() { return file_; }
     Font_file_cptr font_file() const { return file_; }
@@ -194,8 +199,15 @@ public:
         return caret_slope_run_;
     }
 
+    // Loads missing glyph on demand, the rest of its Unicode page
+    // gets loaded in background.
     Master_glyph_ptr glyph(char32_t wc);
 
+    // Tests if the font has glyph for the character.
+    bool covers(char32_t wc) const;
+
+    void set_coverage(Font_coverage_cptr cov);
+
     void set_family(const ustring & family);
     void set_facename(const ustring & facename);
     void set_fontname(const ustring & name);
@@ -214,10 +226,13 @@ public:
 
 private:
 
-    void preload(char32_t first, char32_t last);
+    void load(const std::u32string & s);
+    void request_page(unsigned page);
+    void prefetch();
 
 private:
 
+    // Missing glyphs stored as nullptr.
     using Glyphs = std::map<char32_t, Master_glyph_ptr>;
     using Mutex = std::recursive_mutex;
     using Lock = std::lock_guard<Mutex>;
@@ -238,13 +253,18 @@ private:
     int                 max_x_extent_ = 0;
     bool                caret_slope_rise_ = false;
     bool                caret_slope_run_ = false;
-    mutable Mutex       mx_;
+    mutable Mutex       mx_;                // Guards glyphs_, pages_ and queue_, never held while loading.
     Glyphs              glyphs_;
     Font_file_ptr       file_;
     Master_glyph_ptr    zero_;
-
-    bool                xlatin_ = false;
-    std::string         preloaded_;
+    Font_coverage_cptr  coverage_;
+
+    std::bitset<256>    pages_;             // BMP pages already requested.
+    std::deque<unsigned> queue_;            // BMP pages waiting for prefetch.
+    std::thread         worker_;            // Started by first page request, lives until destruction.
+    std::condition_variable_any wake_;      // Notified when page queued or stop requested.
+    std::atomic<bool>   stop_ { false };
+    std::atomic<bool>   ascii_ { false };   // ASCII preload started.
 };
 
 } // namespace tau
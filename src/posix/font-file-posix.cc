@@ -24,6 +24,7 @@
 // EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 // ----------------------------------------------------------------------------
 
+#include <posix/font-coverage-posix.hh>
 #include <posix/font-face-posix.hh>
 #include <posix/font-file-posix.hh>
 #include <tau/exception.hh>
@@ -34,6 +35,11 @@
 #include <iostream>
 #include <iomanip>
 #include <map>
+#include <mutex>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
 
 namespace {
 
@@ -57,6 +63,85 @@ uint32_t checksum(const char * b, uint32_t size) {
     return cs;
 }
 
+// Read-only content of the font file, mapped into memory when possible
+// and read into the buffer otherwise. Shared by all Font_file_impl
+// instances opened from the same path.
+class Font_data {
+public:
+
+    Font_data(const Font_data & other) = delete;
+    Font_data & operator=(const Font_data & other) = delete;
+
+   ~Font_data() {
+        if (map_) { munmap(map_, size_); }
+    }
+
+    const char * data() const { return data_; }
+    std::size_t size() const { return size_; }
+
+    static std::shared_ptr<Font_data> open(const std::string & lfp);
+
+private:
+
+    Font_data() = default;
+
+    const char *        data_ = nullptr;
+    std::size_t         size_ = 0;
+    void *              map_ = nullptr;
+    std::vector<char>   buffer_;            // Used when mmap() failed.
+};
+
+using Font_data_ptr = std::shared_ptr<Font_data>;
+
+// Font files mapped by path, guarded by dmx_.
+std::mutex                                      dmx_;
+std::map<std::string, std::weak_ptr<Font_data>> datas_;
+
+// static
+Font_data_ptr Font_data::open(const std::string & lfp) {
+    std::lock_guard<std::mutex> lock(dmx_);
+    auto i = datas_.find(lfp);
+
+    if (i != datas_.end()) {
+        if (auto dp = i->second.lock()) { return dp; }
+    }
+
+    Font_data_ptr dp(new Font_data);
+    int fd = ::open(lfp.c_str(), O_RDONLY|O_CLOEXEC);
+
+    if (fd >= 0) {
+        struct stat st;
+
+        if (0 == fstat(fd, &st) && st.st_size > 0) {
+            dp->size_ = st.st_size;
+            void * p = mmap(nullptr, dp->size_, PROT_READ, MAP_PRIVATE, fd, 0);
+
+            if (MAP_FAILED != p) {
+                dp->map_ = p;
+                dp->data_ = static_cast<const char *>(p);
+            }
+        }
+
+        close(fd);
+    }
+
+    if (!dp->data_) {
+        std::ifstream is(lfp, std::ios::binary);
+        if (!is.good()) { return nullptr; }
+        dp->buffer_.assign(std::istreambuf_iterator<char>(is), std::istreambuf_iterator<char>());
+        dp->data_ = dp->buffer_.data();
+        dp->size_ = dp->buffer_.size();
+    }
+
+    for (auto j = datas_.begin(); j != datas_.end(); ) {
+        if (j->second.expired()) { j = datas_.erase(j); }
+        else { ++j; }
+    }
+
+    datas_[lfp] = dp;
+    return dp;
+}
+
 } // anonymous namespace
 
 namespace tau {
@@ -91,11 +176,40 @@ class Font_file_impl: public Font_file {
         std::streamsize len;
     };
 
-    using Char_map = std::map<char32_t, uint16_t>;
+    // Char code -> glyph index mapping made of 256 entry pages,
+    // pages are allocated when first char code within page mapped.
+    struct Char_map {
+        std::vector<uint32_t>   index;  // Page number -> 1+page offset within pages, 0 if no page.
+        std::vector<uint16_t>   pages;
+
+        bool empty() const {
+            return pages.empty();
+        }
+
+        uint16_t find(char32_t wc) const {
+            std::size_t pg = wc >> 8;
+            return pg < index.size() && 0 != index[pg] ? pages[index[pg]-1+(wc & 0xff)] : 0;
+        }
+
+        void set(char32_t wc, uint16_t gindex) {
+            std::size_t pg = wc >> 8;
+            if (pg >= index.size()) { index.resize(1+pg, 0); }
+
+            if (0 == index[pg]) {
+                index[pg] = 1+pages.size();
+                pages.resize(pages.size()+256, 0);
+            }
+
+            pages[index[pg]-1+(wc & 0xff)] = gindex;
+        }
+    };
+
     using Loca_table = std::vector<Loca>;
     using Horz_table = std::vector<Horz_metrics>;
     using Entries = std::map<ustring, Entry>;
 
+    Font_data_ptr       data_;                  // File content, tables parsed in place.
+    Font_coverage_cptr  coverage_;
     Entries             entries_;
     ustring             path_;
     ustring             family_;
@@ -123,25 +237,24 @@ public:
     {
         auto & io = Locale().iocharset();
         std::string lfp = io.is_utf8() ? std::string(path_) : io.encode(path_);
-        std::ifstream is(lfp, std::ios::binary);
+        data_ = Font_data::open(lfp);
 
-        char hdr[12];
-        is.read(hdr, 12);
-
-        if (12 != is.gcount() || 0x00010000 != u32(hdr)) {
+        if (!data_ || data_->size() < 12 || 0x00010000 != u32(data_->data())) {
             throw bad_font(str_format(path_notdir(path_), ": bad header"));
         }
 
+        const char * hdr = data_->data();
         uint16_t ntables = u16(hdr+4);
+
         if (0 != ntables) {
             std::size_t nbytes = 16*ntables;
-            char b[nbytes];
-            is.read(b, nbytes);
 
-            if (nbytes != std::size_t(is.gcount())) {
+            if (12+nbytes > data_->size()) {
                 throw bad_font(str_format(path_notdir(path_), ": corrupted header"));
             }
 
+            const char * b = hdr+12;
+
             for (uint16_t n = 0; n < ntables; ++n) {
                 std::size_t index = 16*n;
                 ustring tag = str_toupper(str_trimright(ustring(b+index, 4)));
@@ -153,8 +266,8 @@ public:
             }
         }
 
-        load_name(is);
-        load_head(is);
+        load_name();
+        load_head();
     }
 
     ustring file_path() const override {
@@ -174,12 +287,9 @@ public:
     }
 
     Font_face_ptr face(Font_file_ptr file, const ustring & family, const ustring & face) override {
-        auto & io = Locale().iocharset();
-        std::string lfp = io.is_utf8() ? std::string(path_) : io.encode(path_);
-        std::ifstream is(lfp, std::ios::binary);
-        preload(is);
+        preload();
         auto zero = std::make_shared<Master_glyph>();
-        load_glyph(is, 0, zero);
+        load_glyph(0, zero);
 
         Font_face_ptr ff = std::make_shared<Font_face>(file, zero);
         ff->set_family(family_);
@@ -197,24 +307,43 @@ public:
         ff->set_max_x_extent(hhea_.max_x_extent);
         ff->set_caret_slope_rise(hhea_.caret_slope_rise);
         ff->set_caret_slope_run(hhea_.caret_slope_run);
+        ff->set_coverage(coverage());
         return ff;
     }
 
+    Font_coverage_cptr coverage() override {
+        if (!coverage_) {
+            preload();
+            auto cov = std::make_shared<Font_coverage>();
+
+            for (std::size_t pg = 0; pg < cmap_.index.size(); ++pg) {
+                if (0 != cmap_.index[pg]) {
+                    const uint16_t * p = cmap_.pages.data()+cmap_.index[pg]-1;
+
+                    for (char32_t wc = 0; wc < 256; ++wc) {
+                        if (0 != p[wc]) { cov->set(256*pg+wc); }
+                    }
+                }
+            }
+
+            coverage_ = cov;
+        }
+
+        return coverage_;
+    }
+
     std::vector<Master_glyph_ptr> glyphs(const ustring & family, const ustring & face, const std::u32string & str) override {
         std::vector<Master_glyph_ptr> gs;
 
         if (family == family_ && face == facename_ && !str.empty()) {
-            auto & io = Locale().iocharset();
-            std::string lfp = io.is_utf8() ? std::string(path_) : io.encode(path_);
-            std::ifstream is(lfp, std::ios::binary);
-            preload(is);
+            preload();
 
             for (char32_t wc: str) {
                 uint16_t gindex = glyph_index(wc);
 
                 if (0 != gindex) {
                     auto master = std::make_shared<Master_glyph>();
-                    load_glyph(is, gindex, master);
+                    load_glyph(gindex, master);
                     gs.push_back(master);
                 }
 
@@ -229,15 +358,12 @@ public:
 
     Master_glyph_ptr glyph(const ustring & family, const ustring & face, char32_t wc) override {
         if (family == family_ && face == facename_) {
-            auto & io = Locale().iocharset();
-            std::string lfp = io.is_utf8() ? std::string(path_) : io.encode(path_);
-            std::ifstream is(lfp, std::ios::binary);
-            preload(is);
+            preload();
             uint16_t gindex = glyph_index(wc);
 
             if (0 != gindex) {
                 auto master = std::make_shared<Master_glyph>();
-                load_glyph(is, gindex, master);
+                load_glyph(gindex, master);
                 return master;
             }
         }
@@ -247,6 +373,23 @@ public:
 
 private:
 
+    // Returns table data within the file, ent receives table's entry.
+    const char * table(const char * tag, const char * who, Entry & ent) {
+        auto ei = entries_.find(tag);
+
+        if (ei == entries_.end()) {
+            throw bad_font(str_format(who, path_notdir(path_), ": missing ", tag, " table"));
+        }
+
+        ent = ei->second;
+
+        if (ent.ofs > data_->size() || ent.len > data_->size()-ent.ofs) {
+            throw bad_font(str_format(who, path_notdir(path_), ": ", tag, " table exceeds file size"));
+        }
+
+        return data_->data()+ent.ofs;
+    }
+
     double conv_2_dot_14(int32_t u) {
         return (static_cast<double>(u & 0xc000)/16384)+(static_cast<double>(u & 0x3fff)/16384);
     }
@@ -303,7 +446,7 @@ private:
     // the glyf table data in pretty good detail (the ascii graphics are a bit silly, but still legible enough).
     // ----------------------------------------------------------------------------
 
-    void load_glyph(std::istream & is, uint16_t gindex, Master_glyph_ptr master) {
+    void load_glyph(uint16_t gindex, Master_glyph_ptr master) {
         if (gindex >= gcount_) {
             throw bad_font(str_format(path_notdir(path_), ": missing required glyph index ", gindex));
         }
@@ -329,25 +472,11 @@ private:
         // Some glyphs, like space (U+0020) has no outlines at all.
         // In that case loca.len will be == 0.
         if (0 != loca.len) {
-            auto ei = entries_.find("GLYF");
+            Entry ent;
+            const char * b = table("GLYF", "", ent)+loca.ofs;
 
-            if (ei == entries_.end()) {
-                throw bad_font(str_format(path_notdir(path_), ": missing GLYF table"));
-            }
-
-            Entry & ent = ei->second;
-            uint32_t fofs = ent.ofs+loca.ofs;
-            is.seekg(fofs, std::ios::beg);
-
-            if (is.tellg() != fofs) {
-                throw bad_font(str_format(path_notdir(path_), ": seek() to GLYF table failed"));
-            }
-
-            char b[loca.len];
-            is.read(b, loca.len);
-
-            if (loca.len != is.gcount()) {
-                throw bad_font(str_format(path_notdir(path_), ": read() failed on GLYF table"));
+            if (loca.ofs > ent.len || loca.len > ent.len-loca.ofs) {
+                throw bad_font(str_format(path_notdir(path_), ": GLYF: glyph ", gindex, " exceeds table size"));
             }
 
             xmin = u16(b+2), ymin = u16(b+4), xmax = u16(b+6), ymax = u16(b+8);
@@ -509,7 +638,7 @@ private:
 
                     // Recursive call!
                     auto sub_master = std::make_shared<Master_glyph>();
-                    load_glyph(is, sub_index, sub_master);
+                    load_glyph(sub_index, sub_master);
 
                     uint16_t arg0, arg1;
 
@@ -635,23 +764,22 @@ private:
     }
 
     uint16_t glyph_index(char32_t wc) {
-        auto iter = cmap_.find(wc);
-        return iter != cmap_.end() ? iter->second : 0;
+        return cmap_.find(wc);
     }
 
-    void preload(std::ifstream & is) {
+    void preload() {
         if (0 == gcount_) {
-            load_maxp(is);
+            load_maxp();
             hmtx_.resize(gcount_);
         }
 
         if (0 == hhea_.rcount) {
-            load_hhea(is);
-            load_hmtx(is);
+            load_hhea();
+            load_hmtx();
         }
 
         if (cmap_.empty()) {
-            load_cmap(is);
+            load_cmap();
 
             if (cmap_.empty()) {
                 throw bad_font(str_format(path_notdir(path_), ": unicode character table not found"));
@@ -659,30 +787,13 @@ private:
         }
 
         if (loca_.empty()) {
-            load_loca(is);
+            load_loca();
         }
     }
 
-    void load_maxp(std::istream & is) {
-        auto ei = entries_.find("MAXP");
-
-        if (ei == entries_.end()) {
-            throw bad_font(str_format("Font_file_posix::load_maxp(): ", path_, ": missing MAXP table"));
-        }
-
-        Entry & ent = ei->second;
-        is.seekg(ent.ofs, std::ios::beg);
-
-        if (is.tellg() != ent.ofs) {
-            throw bad_font(str_format("Font_file_posix::load_maxp(): ", path_, ": failed to seek to MAXP table"));
-        }
-
-        char b[ent.len];
-        is.read(b, ent.len);
-
-        if (ent.len != std::size_t(is.gcount())) {
-            throw bad_font(str_format("Font_file_posix::load_maxp(): ", path_, ": failed to read MAXP table"));
-        }
+    void load_maxp() {
+        Entry ent;
+        const char * b = table("MAXP", "Font_file_posix::load_maxp(): ", ent);
 
         // Table version (+0).
         uint32_t ww = u32(b);
@@ -707,26 +818,9 @@ private:
     }
 
     // Horizontal metrics table.
-    void load_hmtx(std::istream & is) {
-        auto ei = entries_.find("HMTX");
-
-        if (ei == entries_.end()) {
-            throw bad_font(str_format("Font_file_posix::load_hmtx(): ", path_, ": missing HMTX table"));
-        }
-
-        auto ent = ei->second;
-        is.seekg(ent.ofs, std::ios::beg);
-
-        if (is.tellg() != ent.ofs) {
-            throw bad_font(str_format("Font_file_posix::load_hmtx(): ", path_, ": failed to seek to HMTX table"));
-        }
-
-        char b[ent.len];
-        is.read(b, ent.len);
-
-        if (ent.len != std::size_t(is.gcount())) {
-            throw bad_font(str_format("Font_file_posix::load_hmtx(): ", path_, ": failed to read HMTX table"));
-        }
+    void load_hmtx() {
+        Entry ent;
+        const char * b = table("HMTX", "Font_file_posix::load_hmtx(): ", ent);
 
         uint32_t hmto = 0;              // horz long metrics current offset, bytes.
         uint32_t hmtl;                  // horz long metrics limit, bytes.
@@ -763,26 +857,9 @@ private:
     }
 
     // Horizontal header table.
-    void load_hhea(std::istream & is) {
-        auto ei = entries_.find("HHEA");
-
-        if (ei == entries_.end()) {
-            throw bad_font(str_format("Font_file_posix::load_hhea(): ", path_, ": missing HHEA table"));
-        }
-
-        auto ent = ei->second;
-        is.seekg(ent.ofs, std::ios::beg);
-
-        if (is.tellg() != ent.ofs) {
-            throw bad_font(str_format("Font_file_posix::load_hhea(): ", path_, ": failed to seek to HHEA table"));
-        }
-
-        char hhea[ent.len];
-        is.read(hhea, ent.len);
-
-        if (ent.len != std::size_t(is.gcount())) {
-            throw bad_font(str_format("Font_file_posix::load_hhea(): ", path_, ": failed to read HHEA table"));
-        }
+    void load_hhea() {
+        Entry ent;
+        const char * hhea = table("HHEA", "Font_file_posix::load_hhea(): ", ent);
 
         // Table version (+0).
         uint32_t ww = u32(hhea);
@@ -811,26 +888,9 @@ private:
     }
 
     // Glyph location table.
-    void load_loca(std::istream & is) {
-        auto ei = entries_.find("LOCA");
-
-        if (ei == entries_.end()) {
-            throw bad_font(str_format("Font_file_posix::load_loca(): ", path_, ": missing LOCA table"));
-        }
-
-        Entry & ent = ei->second;
-        is.seekg(ent.ofs, std::ios::beg);
-
-        if (is.tellg() != ent.ofs) {
-            throw bad_font(str_format("Font_file_posix::load_loca(): ", path_, ": failed to seek to LOCA table"));
-        }
-
-        char b[ent.len];
-        is.read(b, ent.len);
-
-        if (ent.len != std::size_t(is.gcount())) {
-            throw bad_font(str_format("Font_file_posix::load_loca(): ", path_, ": failed to read LOCA table"));
-        }
+    void load_loca() {
+        Entry ent;
+        const char * b = table("LOCA", "Font_file_posix::load_loca(): ", ent);
 
         uint32_t cs = checksum(b, ent.len);
 
@@ -839,7 +899,7 @@ private:
                                       std::hex, std::setw(8), std::setfill('0'), cs, " != 0x", std::setw(8), ent.cs, ")"));
         }
 
-        ei = entries_.find("GLYF");
+        auto ei = entries_.find("GLYF");
 
         if (ei == entries_.end()) {
             throw bad_font(str_format("Font_file_posix::load_loca(): ", path_, ": missing GLYF table"));
@@ -878,26 +938,9 @@ private:
     }
 
     // Character map table.
-    void load_cmap(std::istream & is) {
-        auto ei = entries_.find("CMAP");
-
-        if (ei == entries_.end()) {
-            throw bad_font(str_format("Font_file_posix::load_cmap(): ", path_, ": missing CMAP table"));
-        }
-
-        Entry & ent = ei->second;
-        is.seekg(ent.ofs, std::ios::beg);
-
-        if (is.tellg() != ent.ofs) {
-            throw bad_font(str_format("Font_file_posix::load_cmap(): ", path_, ": failed to seek to CMAP table"));
-        }
-
-        char b[ent.len];
-        is.read(b, ent.len);
-
-        if (ent.len != std::size_t(is.gcount())) {
-            throw bad_font(str_format("Font_file_posix::load_cmap(): ", path_, ": failed to read CMAP table"));
-        }
+    void load_cmap() {
+        Entry ent;
+        const char * b = table("CMAP", "Font_file_posix::load_cmap(): ", ent);
 
         if (0 != u16(b)) {
             throw bad_font(str_format("Font_file_posix::load_cmap(): ", path_, ": CMAP table version ",
@@ -945,7 +988,7 @@ private:
                         }
 
                         if (gindex <= gcount_) {
-                            cmap_[wc] = gindex;
+                            cmap_.set(wc, gindex);
                         }
                     }
                 }
@@ -955,26 +998,9 @@ private:
         }
     }
 
-    void load_head(std::ifstream & is) {
-        auto ei = entries_.find("HEAD");
-
-        if (ei == entries_.end()) {
-            throw bad_font(str_format("Font_file_posix::load_head(): ", path_, ": missing HEAD table"));
-        }
-
-        Entry & ent = ei->second;
-        is.seekg(ent.ofs, std::ios::beg);
-
-        if (is.tellg() != ent.ofs) {
-            throw bad_font(str_format("Font_file_posix::load_head(): ", path_, ": failed to seek to HEAD table"));
-        }
-
-        char b[ent.len];
-        is.read(b, ent.len);
-
-        if (ent.len != std::size_t(is.gcount())) {
-            throw bad_font(str_format("Font_file_posix::load_head(): ", path_, ": failed to read HEAD table"));
-        }
+    void load_head() {
+        Entry ent;
+        const char * b = table("HEAD", "Font_file_posix::load_head(): ", ent);
 
         // Table version number.
         uint32_t ww = u32(b);
@@ -1043,26 +1069,9 @@ private:
         loca32_ = (0 != locaf);
     }
 
-    void load_name(std::ifstream & is) {
-        auto ei = entries_.find("NAME");
-
-        if (ei == entries_.end()) {
-            throw bad_font(str_format(path_notdir(path_), ": missing NAME table"));
-        }
-
-        Entry & ent = ei->second;
-        is.seekg(ent.ofs, std::ios::beg);
-
-        if (is.tellg() != ent.ofs) {
-            throw bad_font(str_format(path_notdir(path_), ": failed to seek to NAME table"));
-        }
-
-        char b[ent.len];
-        is.read(b, ent.len);
-
-        if (ent.len != std::size_t(is.gcount())) {
-            throw bad_font(str_format(path_notdir(path_), ": failed to read NAME table"));
-        }
+    void load_name() {
+        Entry ent;
+        const char * b = table("NAME", "", ent);
 
         ustring fam8,  fam16;
         ustring face8, face16;
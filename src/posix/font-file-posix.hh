@@ -50,6 +50,9 @@ public:
     virtual Master_glyph_ptr glyph(const ustring & family, const ustring & face, char32_t wc) = 0;
     virtual std::vector<Master_glyph_ptr> glyphs(const ustring & family, const ustring & face, const std::u32string & str) = 0;
 
+    // Returns characters having glyphs.
+    virtual Font_coverage_cptr coverage() = 0;
+
 };
 
 } // namespace tau
@@ -61,6 +61,11 @@ Glyph_ptr Font_posix::glyph(char32_t wc) {
     return gl;
 }
 
+// Overrides Font_impl.
+bool Font_posix::has_glyph(char32_t wc) const {
+    return face_->covers(wc);
+}
+
 } // namespace tau
 
 //END
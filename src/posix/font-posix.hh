@@ -80,6 +80,9 @@ public:
     // Overrides pure Font_impl.
     Glyph_ptr glyph(char32_t wc) override;
 
+    // Overrides Font_impl.
+    bool has_glyph(char32_t wc) const override;
+
 protected:
 
     using Glyph_map = std::map<char32_t, Glyph_ptr>;
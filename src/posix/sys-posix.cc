@@ -32,8 +32,10 @@
 #include <locale-impl.hh>
 #include <sys-impl.hh>
 #include "theme-posix.hh"
+#include <sys/mman.h>
 #include <sys/stat.h>
 #include <dirent.h>
+#include <fcntl.h>
 #include <fnmatch.h>
 #include <glob.h>
 #include <pwd.h>
@@ -266,6 +268,40 @@ void msleep(unsigned time_ms) {
     usleep(1000*time_ms);
 }
 
+File_map::File_map(const ustring & path) {
+    auto & io = Locale().iocharset();
+    std::string lfp = io.is_utf8() ? std::string(path) : io.encode(path);
+    int fd = open(lfp.c_str(), O_RDONLY|O_CLOEXEC);
+    if (fd < 0) { throw sys_error(path); }
+    struct stat st;
+
+    if (0 != fstat(fd, &st)) {
+        sys_error x(path);
+        close(fd);
+        throw x;
+    }
+
+    if (st.st_size > 0) {
+        void * p = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+
+        if (MAP_FAILED == p) {
+            sys_error x(path);
+            close(fd);
+            throw x;
+        }
+
+        handle_ = p;
+        data_ = static_cast<const char *>(p);
+        size_ = st.st_size;
+    }
+
+    close(fd);
+}
+
+File_map::~File_map() {
+    if (handle_) { munmap(handle_, size_); }
+}
+
 // static
 std::vector<ustring> Font::list_families() {
     return Theme_posix::root_posix()->list_families();
@@ -25,14 +25,22 @@
 // ----------------------------------------------------------------------------
 
 #include <tau/exception.hh>
+#include <tau/fileinfo.hh>
+#include <tau/locale.hh>
 #include <tau/string.hh>
 #include <tau/sys.hh>
+#include "font-coverage-posix.hh"
 #include "font-face-posix.hh"
 #include "font-file-posix.hh"
 #include "font-posix.hh"
 #include "theme-posix.hh"
+#include <condition_variable>
+#include <cstdio>
+#include <fstream>
 #include <mutex>
 #include <iostream>
+#include <unordered_set>
+#include <unistd.h>
 
 namespace {
 
@@ -40,7 +48,11 @@ using Mutex = std::recursive_mutex;
 using Lock = std::lock_guard<Mutex>;
 
 Mutex                   mx_;
-tau::Theme_posix_ptr    root_;
+
+// Font registry is filled by the scanner thread, rmx_ guards reg_ and families_.
+std::mutex              rmx_;
+std::condition_variable rcv_;           // Notified when font file registered.
+bool                    scanned_ = false; // Scanner finished.
 
 using Faces = std::list<tau::ustring>;
 
@@ -62,15 +74,107 @@ struct Registry {
     tau::ustring        face;       // Possibly synthesized face name.
     tau::Font_face_ptr  faceptr;
     tau::Font_file_ptr  ttf;
+    tau::Font_coverage_cptr coverage;
+};
+
+// Font file information kept within on-disk registry cache.
+struct Font_record {
+    uint64_t            mtime = 0;
+    uint64_t            bytes = 0;
+    tau::Font_coverage_cptr coverage;
+    std::vector<std::pair<tau::ustring, tau::ustring>> faces; // Family and face names, empty for bad fonts.
+    bool                used = false;   // File found during current scan.
 };
 
 using Families  = std::unordered_map<std::string, Family_holder>;
 using Cache     = std::unordered_map<std::string, Font_holder>;
 using Registrar = std::unordered_map<std::string, Registry>;
+using Records   = std::unordered_map<std::string, Font_record>;
+
+// Chosen fallback registry keys: face key -> character -> registry key.
+using Fallbacks = std::unordered_map<std::string, std::unordered_map<char32_t, std::string>>;
 
 Families        families_;
 Cache           cache_;
 Registrar       reg_;
+Records         records_;               // Owned by scanner thread after boot.
+bool            records_changed_ = false;
+Fallbacks       fallbacks_;             // Guarded by rmx_.
+std::unordered_set<std::string> paths_; // Font file paths found by scanner.
+
+// Defined after the registry, so destroyed (and scanner thread joined) before it.
+tau::Theme_posix_ptr root_;
+
+const char *    records_magic_ = "tau-font-registry 2";
+
+std::string local_path(const tau::ustring & path) {
+    auto & io = tau::Locale().iocharset();
+    return io.is_utf8() ? std::string(path) : io.encode(path);
+}
+
+tau::ustring records_path() {
+    return tau::path_build(tau::path_user_cache_dir(), "tau", "font-registry");
+}
+
+// Record format, one file per line, fields are separated by tabs:
+// path mtime bytes coverage [family face]...
+// Coverage is written by Font_coverage::str(), "-" when empty.
+void load_records() {
+    std::ifstream is(local_path(records_path()));
+    std::string line;
+
+    if (!std::getline(is, line) || records_magic_ != line) {
+        records_changed_ = true;
+        return;
+    }
+
+    while (std::getline(is, line)) {
+        auto v = tau::str_explode(tau::ustring(line), '\t');
+
+        if (v.size() >= 4 && 0 == v.size() % 2) {
+            Font_record rec;
+            rec.mtime = std::strtoull(v[1].c_str(), nullptr, 10);
+            rec.bytes = std::strtoull(v[2].c_str(), nullptr, 10);
+            rec.coverage = tau::Font_coverage::from_str(v[3]);
+            for (std::size_t n = 4; n < v.size(); n += 2) { rec.faces.emplace_back(v[n], v[n+1]); }
+            records_[v[0]] = rec;
+        }
+    }
+}
+
+// Writes the cache into temporary file, which then renamed over the old one.
+void save_records() {
+    if (!records_changed_) { return; }
+    tau::ustring path = records_path();
+    tau::ustring tmp = tau::str_format(path, '.', getpid());
+
+    try {
+        tau::path_mkdir(tau::path_dirname(path));
+        std::ofstream os(local_path(tmp));
+        os << records_magic_ << '\n';
+
+        for (auto & p: records_) {
+            if (std::string::npos != p.first.find_first_of("\t\n")) { continue; }
+            std::string cov = p.second.coverage ? p.second.coverage->str() : std::string();
+            os << p.first << '\t' << p.second.mtime << '\t' << p.second.bytes << '\t' << (cov.empty() ? "-" : cov);
+            for (auto & f: p.second.faces) { os << '\t' << f.first << '\t' << f.second; }
+            os << '\n';
+        }
+
+        os.close();
+
+        if (os.good() && 0 == std::rename(local_path(tmp).c_str(), local_path(path).c_str())) {
+            records_changed_ = false;
+            return;
+        }
+    }
+
+    catch (tau::exception & x) {
+        std::cerr << "** Theme_posix: failed to write font registry cache: " << x.what() << std::endl;
+    }
+
+    std::remove(local_path(tmp).c_str());
+}
 
 std::string font_family_key(const tau::ustring & family_name) {
     return tau::str_toupper(tau::str_trim(family_name));
@@ -80,13 +184,14 @@ std::string partial_key(const tau::ustring & family, const tau::ustring & face)
     return tau::str_toupper(tau::str_trim(tau::str_format(family, ' ', face)));
 }
 
-Registry & register_font(tau::Font_file_ptr ttf, const tau::ustring & fam, const tau::ustring & face) {
+Registry & register_font(const tau::ustring & path, const tau::ustring & ffamily, const tau::ustring & fface, const tau::ustring & fam, const tau::ustring & face, tau::Font_coverage_cptr cov) {
     std::string key = partial_key(fam, face);
     auto p = reg_.emplace(std::make_pair(key, Registry()));
     auto & reg = p.first->second;
-    reg.path = ttf->file_path();
-    reg.ffamily = ttf->list_families().front();
-    reg.fface = ttf->list_faces(reg.ffamily).front();
+    reg.path = path;
+    reg.coverage = cov;
+    reg.ffamily = ffamily;
+    reg.fface = fface;
     reg.family = fam;
     reg.face = face;
     reg_[key] = reg;
@@ -114,6 +219,40 @@ Registry & register_font(tau::Font_file_ptr ttf, const tau::ustring & fam, const
     return reg;
 }
 
+void register_record(const tau::ustring & path, const Font_record & rec) {
+    for (auto & f: rec.faces) {
+        auto specv = tau::font_spec_explode(tau::font_spec_build(f.first, f.second));
+        auto famf = tau::font_family_from_spec(specv);
+        auto facef = tau::font_face_from_spec(specv);
+        register_font(path, f.first, f.second, famf, facef, rec.coverage);
+        if (tau::str_similar(facef, "Oblique")) { register_font(path, f.first, f.second, famf, "Italic", rec.coverage); }
+        if (tau::str_similar(facef, "Normal")) { register_font(path, f.first, f.second, famf, "Regular", rec.coverage); }
+        if (tau::str_similar(facef, "Book")) { register_font(path, f.first, f.second, famf, "Regular", rec.coverage); }
+    }
+
+    fallbacks_.clear();
+}
+
+// Removes fonts registered from the file, families_ should be rebuilt then.
+void unregister_path(const tau::ustring & path) {
+    for (auto i = reg_.begin(); i != reg_.end(); ) {
+        if (path == i->second.path) { i = reg_.erase(i); }
+        else { ++i; }
+    }
+
+    fallbacks_.clear();
+}
+
+void rebuild_families() {
+    families_.clear();
+
+    for (auto & p: reg_) {
+        auto & hol = families_[font_family_key(p.second.family)];
+        if (hol.family.empty()) { hol.family = p.second.family; }
+        if (hol.faces.end() == std::find(hol.faces.begin(), hol.faces.end(), p.second.face)) { hol.faces.push_back(p.second.face); }
+    }
+}
+
 } // anonymous namespace
 
 namespace tau {
@@ -135,6 +274,11 @@ Theme_ptr Theme_impl::root() {
     return Theme_posix::root_posix();
 }
 
+Theme_posix::~Theme_posix() {
+    stop_ = true;
+    if (scanner_.joinable()) { scanner_.join(); }
+}
+
 // Overrides Theme_impl.
 void Theme_posix::boot() {
     Theme_impl::boot();
@@ -156,15 +300,24 @@ void Theme_posix::boot() {
 
     // Setup fonts.
 
-    init_font_dir(path_build(path_prefix(), "fonts"));
-    init_font_dir(path_build(path_home(), ".fonts"));
-    init_font_dir("/usr/share/fonts");
-    init_font_dir("/usr/local/share/fonts");
+    // Cached fonts are available at once, the scanner thread checks them
+    // and registers fonts not cached yet.
+    load_records();
+
+    // With warm cache, default fonts looked up without waiting for the scanner.
+    bool wait = records_.empty() || records_changed_;
+
+    {
+        std::lock_guard<std::mutex> lock(rmx_);
+        for (auto & p: records_) { register_record(p.first, p.second); }
+    }
+
+    scanner_ = std::thread(&Theme_posix::scan_fonts, this);
 
     const ustring nice_fonts = "Ubuntu:Droid Sans:DejaVu Sans Book:Noto Sans:Free Sans"; // FIXME add more nice fonts.
 
     for (const ustring & s: str_explode(nice_fonts, ':')) {
-        if (auto facep = create_font_face(s)) {
+        if (auto facep = create_font_face(s, wait)) {
             font_mono_ = font_normal_ = font_size_change(s, 10);
             break;
         }
@@ -173,7 +326,7 @@ void Theme_posix::boot() {
     for (const ustring & s: str_explode(nice_fonts, ':')) {
         ustring ms = font_face_add(s, "Mono");
 
-        if (auto facep = create_font_face(ms)) {
+        if (auto facep = create_font_face(ms, wait)) {
             font_mono_ = font_size_change(ms, 10);
             break;
         }
@@ -193,22 +346,59 @@ void Theme_posix::sweep() {
     cleanup_font_cache();
 }
 
-Font_face_ptr Theme_posix::create_font_face(const ustring & spec) {
-    Lock lock(mx_);
+// If wait is true, blocks until the font registered or font scanning finished,
+// otherwise looks up fonts registered so far.
+// The font file is parsed outside of the lock, the result published under it.
+Font_face_ptr Theme_posix::create_font_face(const ustring & spec, bool wait) {
     auto v = font_spec_explode(spec);
     ustring family = font_family_from_spec(v), face = font_face_from_spec(v);
-    auto i = reg_.find(partial_key(family, face));
+    std::string key = partial_key(family, face);
+    ustring path, ffamily, fface;
+    Font_file_ptr ttf;
+
+    {
+        std::unique_lock<std::mutex> lock(rmx_);
+        auto i = reg_.find(key);
 
-    if (i != reg_.end()) {
+        while (wait && i == reg_.end() && !scanned_) {
+            rcv_.wait(lock);
+            i = reg_.find(key);
+        }
+
+        if (i == reg_.end()) { return nullptr; }
+        if (i->second.faceptr) { return i->second.faceptr; }
+        path = i->second.path;
+        ffamily = i->second.ffamily;
+        fface = i->second.fface;
+        ttf = i->second.ttf;
+    }
+
+    Font_face_ptr facep;
+
+    try {
+        if (!ttf) { ttf = Font_file::create(path); }
+        facep = ttf->face(ttf, ffamily, fface);
+    }
+
+    catch (bad_font & bf) {
+        std::cerr << "** Theme_posix::create_font_face(): " << bf.what() << std::endl;
+        return nullptr;
+    }
+
+    // Other thread may have created the face meanwhile.
+    std::lock_guard<std::mutex> lock(rmx_);
+    auto i = reg_.find(key);
+
+    if (i != reg_.end() && path == i->second.path) {
         if (!i->second.faceptr) {
-            if (!i->second.ttf) { i->second.ttf = Font_file::create(i->second.path); }
-            i->second.faceptr = i->second.ttf->face(i->second.ttf, i->second.ffamily, i->second.fface);
+            i->second.ttf = ttf;
+            i->second.faceptr = facep;
         }
 
         return i->second.faceptr;
     }
 
-    return nullptr;
+    return facep;
 }
 
 void Theme_posix::cache_font(Font_ptr font, const ustring & spec) {
@@ -239,9 +429,11 @@ Font_ptr Theme_posix::uncache_font(const ustring & spec, unsigned dpi) {
     return font;
 }
 
+// Blocks until font scanning finished.
 std::vector<ustring> Theme_posix::list_families() {
     std::vector<ustring> v;
-    Lock lock(mx_);
+    std::unique_lock<std::mutex> lock(rmx_);
+    rcv_.wait(lock, [] { return scanned_; });
 
     for (auto & reg: reg_) {
         if (!str_similar(reg.second.family, v)) {
@@ -252,9 +444,11 @@ std::vector<ustring> Theme_posix::list_families() {
     return v;
 }
 
+// Blocks until font scanning finished.
 std::vector<ustring> Theme_posix::list_faces(const ustring & family) {
     std::vector<ustring> v;
-    Lock lock(mx_);
+    std::unique_lock<std::mutex> lock(rmx_);
+    rcv_.wait(lock, [] { return scanned_; });
 
     auto i = families_.find(font_family_key(family));
 
@@ -269,6 +463,47 @@ std::vector<ustring> Theme_posix::list_faces(const ustring & family) {
     return v;
 }
 
+// Overrides Theme_impl.
+// The choice is remembered per face and character, so only the first
+// lookup of the character has to test coverage of registered fonts.
+ustring Theme_posix::font_fallback(const ustring & spec, char32_t wc) {
+    auto v = font_spec_explode(spec);
+    ustring face = font_face_from_spec(v);
+    std::string fkey = str_toupper(str_trim(face));
+    std::lock_guard<std::mutex> lock(rmx_);
+    auto & chars = fallbacks_[fkey];
+    auto i = chars.find(wc);
+
+    if (i == chars.end()) {
+        std::string best;
+        int best_score = 0;
+
+        for (auto & p: reg_) {
+            if (p.second.coverage && p.second.coverage->test(wc)) {
+                // Prefer the same face, then the regular one.
+                int score = str_similar(p.second.face, face) ? 3 : (str_similar(p.second.face, "Regular") ? 2 : 1);
+
+                if (score > best_score || (score == best_score && p.first < best)) {
+                    best = p.first;
+                    best_score = score;
+                }
+            }
+        }
+
+        i = chars.emplace(wc, best).first;
+    }
+
+    if (!i->second.empty()) {
+        auto j = reg_.find(i->second);
+
+        if (j != reg_.end()) {
+            return font_spec_build(j->second.family, j->second.face, font_size_from_spec(v));
+        }
+    }
+
+    return ustring();
+}
+
 void Theme_posix::cleanup_font_cache() {
     Timeval now = Timeval::now();
     Lock lock(mx_);
@@ -289,31 +524,90 @@ void Theme_posix::cleanup_font_cache() {
     }
 }
 
+// private
+// Runs within scanner thread.
+void Theme_posix::scan_fonts() {
+    init_font_dir(path_build(path_prefix(), "fonts"));
+    init_font_dir(path_build(path_home(), ".fonts"));
+    init_font_dir("/usr/share/fonts");
+    init_font_dir("/usr/local/share/fonts");
+
+    if (!stop_) {
+        std::vector<ustring> gone;
+
+        for (auto i = records_.begin(); i != records_.end(); ) {
+            if (i->second.used) { ++i; }
+            else { gone.push_back(i->first); i = records_.erase(i); records_changed_ = true; }
+        }
+
+        if (!gone.empty()) {
+            std::lock_guard<std::mutex> lock(rmx_);
+            for (auto & path: gone) { unregister_path(path); }
+            rebuild_families();
+        }
+
+        save_records();
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(rmx_);
+        scanned_ = true;
+    }
+
+    rcv_.notify_all();
+}
+
+// private
+// Font files not changed since the last scan are already registered using
+// cached family and face names, other files are parsed and registered.
 void Theme_posix::init_font_dir(const ustring & dir) {
     if (file_is_dir(dir)) {
         for (auto & fp: path_find(dir)) {
+            if (stop_) { return; }
+
             if (!file_is_dir(fp)) {
                 if (str_has_suffix(str_tolower(fp), ".ttf")) {
-                    try {
-                        if (reg_.end() == std::find_if(reg_.begin(), reg_.end(), [&fp](auto & p) { return fp == p.second.path; } )) {
+                    if (!paths_.insert(fp).second) { continue; }
+                    Fileinfo fi(fp);
+                    uint64_t mtime = fi.mtime(), bytes = fi.bytes();
+                    Font_record & rec = records_[fp];
+                    rec.used = true;
+
+                    if (rec.mtime != mtime || rec.bytes != bytes) {
+                        bool cached = !rec.faces.empty();
+                        rec.mtime = mtime;
+                        rec.bytes = bytes;
+                        rec.faces.clear();
+                        rec.coverage.reset();
+                        records_changed_ = true;
+
+                        try {
                             Font_file_ptr ttf = Font_file::create(fp);
+                            rec.coverage = ttf->coverage();
 
                             for (auto & fam: ttf->list_families()) {
                                 for (auto & face: ttf->list_faces(fam)) {
-                                    auto specv = font_spec_explode(tau::font_spec_build(fam, face));
-                                    auto famf = font_family_from_spec(specv);
-                                    auto facef = font_face_from_spec(specv);
-                                    register_font(ttf, famf, facef);
-                                    if (str_similar(facef, "Oblique")) { register_font(ttf, famf, "Italic"); }
-                                    if (str_similar(facef, "Normal")) { register_font(ttf, famf, "Regular"); }
-                                    if (str_similar(facef, "Book")) { register_font(ttf, famf, "Regular"); }
+                                    rec.faces.emplace_back(fam, face);
                                 }
                             }
                         }
-                    }
 
-                    catch (bad_font & bf) {
-                        std::cerr << "** Theme_posix::init_font_dir(): " << bf.what() << std::endl;
+                        catch (bad_font & bf) {
+                            std::cerr << "** Theme_posix::init_font_dir(): " << bf.what() << std::endl;
+                        }
+
+                        {
+                            std::lock_guard<std::mutex> lock(rmx_);
+
+                            if (cached) {
+                                unregister_path(fp);
+                                rebuild_families();
+                            }
+
+                            register_record(fp, rec);
+                        }
+
+                        rcv_.notify_all();
                     }
                 }
             }
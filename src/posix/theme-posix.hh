@@ -29,20 +29,27 @@
 
 #include "types-posix.hh"
 #include <theme-impl.hh>
+#include <atomic>
+#include <thread>
 
 namespace tau {
 
 class Theme_posix: public Theme_impl {
 public:
 
+   ~Theme_posix();
+
     static Theme_posix_ptr root_posix();
 
-    Font_face_ptr create_font_face(const ustring & spec);
+    Font_face_ptr create_font_face(const ustring & spec, bool wait=true);
     void cache_font(Font_ptr font, const ustring & spec);
     Font_ptr uncache_font(const ustring & spec, unsigned dpi);
     std::vector<ustring> list_families();
     std::vector<ustring> list_faces(const ustring & family);
 
+    // Overrides Theme_impl.
+    ustring font_fallback(const ustring & spec, char32_t wc) override;
+
 protected:
 
     // Overrides Theme_impl.
@@ -53,6 +60,12 @@ protected:
 
 private:
 
+    std::thread         scanner_;           // Font scanner thread.
+    std::atomic<bool>   stop_ { false };    // Stop scanner thread.
+
+private:
+
+    void scan_fonts();
     void init_font_dir(const ustring & dir);
     void cleanup_font_cache();
 };
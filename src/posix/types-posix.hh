@@ -38,6 +38,10 @@ class Font_face;
 using Font_face_ptr = std::shared_ptr<Font_face>;
 using Font_face_cptr = std::shared_ptr<const Font_face>;
 
+class Font_coverage;
+using Font_coverage_ptr = std::shared_ptr<Font_coverage>;
+using Font_coverage_cptr = std::shared_ptr<const Font_coverage>;
+
 class Font_file;
 using Font_file_ptr = std::shared_ptr<Font_file>;
 using Font_file_cptr = std::shared_ptr<const Font_file>;
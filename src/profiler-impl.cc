@@ -0,0 +1,162 @@
+// ----------------------------------------------------------------------------
+// Copyright © 2014-2023 Konstantin Shmelkov <mrcashe@gmail.com>.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+// PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+// OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+// WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+// OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+// EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+// ----------------------------------------------------------------------------
+
+#include <tau/sys.hh>
+#include <tau/timeval.hh>
+#include <profiler-impl.hh>
+#include <widget-impl.hh>
+#include <fstream>
+#include <iostream>
+#include <typeinfo>
+
+#if defined(__GNUC__)
+#include <cxxabi.h>
+#include <cstdlib>
+#endif
+
+namespace {
+
+std::string class_name(const tau::Widget_impl * wi) {
+    const char * name = typeid(*wi).name();
+
+#if defined(__GNUC__)
+    int status = 0;
+
+    if (char * dn = abi::__cxa_demangle(name, nullptr, nullptr, &status)) {
+        std::string s(dn);
+        std::free(dn);
+        return s;
+    }
+#endif
+
+    return name;
+}
+
+const tau::ustring & env_value() {
+    static const tau::ustring value = tau::str_env("TAU_PAINT_PROFILE");
+    return value;
+}
+
+} // anonymous namespace
+
+namespace tau {
+
+// static
+bool Paint_profiler::env_enabled() {
+    return !env_value().empty();
+}
+
+void Paint_profiler::begin_frame() {
+    recs_.clear();
+    stack_.clear();
+    start_ = Timeval::now();
+}
+
+void Paint_profiler::end_frame(uint64_t extra_requests) {
+    while (!stack_.empty()) { leave(stack_.back().requests); }
+    frame_us_ = uint64_t(Timeval::now())-start_;
+    extra_ = extra_requests;
+    last_.swap(recs_);
+    recs_.clear();
+    ++frame_;
+}
+
+void Paint_profiler::enter(const Widget_impl * wi, bool backpaint, uint64_t requests) {
+    Entry e;
+    e.rec = recs_.size();
+    e.requests = requests;
+    recs_.emplace_back();
+    Paint_profile & rec = recs_.back();
+    rec.widget = class_name(wi);
+    rec.depth = stack_.size();
+    rec.parent = stack_.empty() ? -1 : int(stack_.back().rec);
+    rec.backpaint = backpaint;
+    stack_.push_back(e);
+    stack_.back().start = Timeval::now();
+}
+
+void Paint_profiler::leave(uint64_t requests) {
+    if (!stack_.empty()) {
+        uint64_t now = Timeval::now();
+        Entry e = stack_.back();
+        stack_.pop_back();
+        uint64_t us = now-e.start, req = requests >= e.requests ? requests-e.requests : 0;
+        Paint_profile & rec = recs_[e.rec];
+        rec.total_us = us;
+        rec.self_us = us >= e.child_us ? us-e.child_us : 0;
+        rec.requests = req >= e.child_req ? req-e.child_req : 0;
+
+        if (!stack_.empty()) {
+            stack_.back().child_us += us;
+            stack_.back().child_req += req;
+        }
+    }
+}
+
+void Paint_profiler::dump(std::ostream & os, const void * window) const {
+    os << "{\"frame\":" << frame_ << ",\"window\":\"" << window << "\",\"us\":" << frame_us_
+       << ",\"extra_requests\":" << extra_ << ",\"widgets\":[";
+
+    for (std::size_t n = 0; n < last_.size(); ++n) {
+        const Paint_profile & rec = last_[n];
+        if (0 != n) { os << ','; }
+        os << "{\"widget\":\"";
+
+        for (char c: rec.widget) {
+            if ('"' == c || '\\' == c) { os << '\\'; }
+            os << c;
+        }
+
+        os << "\",\"depth\":" << rec.depth << ",\"parent\":" << rec.parent
+           << ",\"backpaint\":" << (rec.backpaint ? "true" : "false")
+           << ",\"total_us\":" << rec.total_us << ",\"self_us\":" << rec.self_us
+           << ",\"contours\":" << rec.contours << ",\"rects\":" << rec.rects
+           << ",\"arcs\":" << rec.arcs << ",\"texts\":" << rec.texts
+           << ",\"pixmaps\":" << rec.pixmaps << ",\"pixels\":" << rec.pixels
+           << ",\"requests\":" << rec.requests << '}';
+    }
+
+    os << "]}" << std::endl;
+}
+
+void Paint_profiler::dump_env(const void * window) const {
+    const ustring & path = env_value();
+
+    if (!path.empty()) {
+        if ("-" == path) {
+            dump(std::cerr, window);
+        }
+
+        else {
+            static std::ofstream os(path.c_str(), std::ios::out|std::ios::app);
+            if (os.good()) { dump(os, window); }
+        }
+    }
+}
+
+} // namespace tau
+
+//END
@@ -0,0 +1,89 @@
+// ----------------------------------------------------------------------------
+// Copyright © 2014-2023 Konstantin Shmelkov <mrcashe@gmail.com>.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+// PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+// OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+// WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+// OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+// EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+// ----------------------------------------------------------------------------
+
+#ifndef TAU_PROFILER_IMPL_HH
+#define TAU_PROFILER_IMPL_HH
+
+#include <tau/window.hh>
+#include <types-impl.hh>
+#include <cstdint>
+#include <ostream>
+#include <string>
+
+namespace tau {
+
+// Collects per widget paint statistics during a frame, see Window::enable_paint_profile().
+// The painter reports widgets being painted using enter() and leave() and
+// counts primitives into current() record.
+class Paint_profiler {
+public:
+
+    void begin_frame();
+
+    // Extra requests are those issued by the window after painting (buffer copies).
+    void end_frame(uint64_t extra_requests);
+
+    void enter(const Widget_impl * wi, bool backpaint, uint64_t requests);
+    void leave(uint64_t requests);
+
+    // Returns nullptr outside of enter()/leave() pair.
+    Paint_profile * current() { return stack_.empty() ? nullptr : &recs_[stack_.back().rec]; }
+
+    // Records of the last finished frame.
+    const std::vector<Paint_profile> & records() const { return last_; }
+
+    // Writes the last finished frame as single line JSON object.
+    void dump(std::ostream & os, const void * window) const;
+
+    // Writes the last finished frame into the stream given by TAU_PAINT_PROFILE
+    // environment variable, does nothing when variable is not set.
+    void dump_env(const void * window) const;
+
+    // Tests if TAU_PAINT_PROFILE environment variable is set.
+    static bool env_enabled();
+
+private:
+
+    struct Entry {
+        std::size_t     rec;
+        uint64_t        start;          // Entry time, in microseconds.
+        uint64_t        requests;       // Requests issued before entry.
+        uint64_t        child_us = 0;   // Time spent by children.
+        uint64_t        child_req = 0;  // Requests issued by children.
+    };
+
+    std::vector<Paint_profile> recs_;
+    std::vector<Paint_profile> last_;
+    std::vector<Entry> stack_;
+    uint64_t            frame_ = 0;     // Number of frames finished.
+    uint64_t            start_ = 0;     // Frame start time, in microseconds.
+    uint64_t            frame_us_ = 0;  // Duration of the last frame.
+    uint64_t            extra_ = 0;     // Extra requests of the last frame.
+};
+
+} // namespace tau
+
+#endif // TAU_PROFILER_IMPL_HH
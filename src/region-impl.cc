@@ -0,0 +1,229 @@
+// ----------------------------------------------------------------------------
+// Copyright © 2014-2023 Konstantin Shmelkov <mrcashe@gmail.com>.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+// PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+// OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+// WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+// OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+// EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+// ----------------------------------------------------------------------------
+
+#include <region-impl.hh>
+#include <algorithm>
+#include <climits>
+
+namespace {
+
+using Box = tau::Region::Box;
+using Spans = std::vector<std::pair<int, int>>;
+
+// Collects spans of the band covering scanlines [y1, y2) starting from p.
+// p advanced past bands ending at or above y1.
+const Box * band_spans(const Box * p, const Box * end, int y1, Spans & spans) {
+    spans.clear();
+    while (p != end && p->y2 <= y1) { ++p; }
+
+    for (const Box * q = p; q != end && q->y1 <= y1; ++q) {
+        spans.emplace_back(q->x1, q->x2);
+    }
+
+    return p;
+}
+
+// Merges two sorted span lists according to op.
+void merge_spans(const Spans & a, const Spans & b, int op, Spans & out) {
+    out.clear();
+
+    if (0 == op) {              // Union.
+        auto i = a.begin(), j = b.begin();
+
+        while (i != a.end() || j != b.end()) {
+            std::pair<int, int> s = (j == b.end() || (i != a.end() && i->first <= j->first)) ? *i++ : *j++;
+            if (!out.empty() && s.first <= out.back().second) { out.back().second = std::max(out.back().second, s.second); }
+            else { out.push_back(s); }
+        }
+    }
+
+    else if (1 == op) {         // Intersection.
+        auto i = a.begin(), j = b.begin();
+
+        while (i != a.end() && j != b.end()) {
+            int x1 = std::max(i->first, j->first), x2 = std::min(i->second, j->second);
+            if (x1 < x2) { out.emplace_back(x1, x2); }
+            if (i->second < j->second) { ++i; } else { ++j; }
+        }
+    }
+
+    else {                      // Subtraction.
+        auto j = b.begin();
+
+        for (auto s: a) {
+            while (j != b.end() && j->second <= s.first) { ++j; }
+
+            for (auto k = j; k != b.end() && k->first < s.second; ++k) {
+                if (k->first > s.first) { out.emplace_back(s.first, k->first); }
+                s.first = std::max(s.first, k->second);
+            }
+
+            if (s.first < s.second) { out.push_back(s); }
+        }
+    }
+}
+
+} // anonymous namespace
+
+namespace tau {
+
+Region::Region(const Rect & r) {
+    if (r) { boxes_.push_back({ r.left(), r.top(), r.left()+r.iwidth(), r.top()+r.iheight() }); }
+}
+
+// static
+Rect Region::to_rect(const Box & b) {
+    return Rect(Point(b.x1, b.y1), Size(b.x2-b.x1, b.y2-b.y1));
+}
+
+Rect Region::bounds() const {
+    if (boxes_.empty()) { return Rect(); }
+    int x1 = INT_MAX, x2 = INT_MIN;
+    for (const Box & b: boxes_) { x1 = std::min(x1, b.x1); x2 = std::max(x2, b.x2); }
+    return to_rect({ x1, boxes_.front().y1, x2, boxes_.back().y2 });
+}
+
+std::vector<Rect> Region::rects() const {
+    std::vector<Rect> v;
+    v.reserve(boxes_.size());
+    for (const Box & b: boxes_) { v.push_back(to_rect(b)); }
+    return v;
+}
+
+uint64_t Region::area() const {
+    uint64_t a = 0;
+    for (const Box & b: boxes_) { a += uint64_t(b.x2-b.x1)*uint64_t(b.y2-b.y1); }
+    return a;
+}
+
+bool Region::contains(const Point & pt) const {
+    for (const Box & b: boxes_) {
+        if (b.y1 > pt.y()) { break; }
+        if (pt.y() < b.y2 && pt.x() >= b.x1 && pt.x() < b.x2) { return true; }
+    }
+
+    return false;
+}
+
+bool Region::intersects(const Rect & r) const {
+    if (!r) { return false; }
+    int x1 = r.left(), y1 = r.top(), x2 = x1+r.iwidth(), y2 = y1+r.iheight();
+
+    for (const Box & b: boxes_) {
+        if (b.y1 >= y2) { break; }
+        if (b.y2 > y1 && b.x1 < x2 && b.x2 > x1) { return true; }
+    }
+
+    return false;
+}
+
+void Region::unite(const Rect & r) {
+    if (r) { combine(Region(r), UNION); }
+}
+
+void Region::unite(const Region & other) {
+    if (boxes_.empty()) { boxes_ = other.boxes_; }
+    else if (!other.empty()) { combine(other, UNION); }
+}
+
+void Region::intersect(const Rect & r) {
+    if (!boxes_.empty()) { combine(Region(r), INTERSECT); }
+}
+
+void Region::intersect(const Region & other) {
+    if (!boxes_.empty()) { combine(other, INTERSECT); }
+}
+
+void Region::subtract(const Rect & r) {
+    if (!boxes_.empty() && r) { combine(Region(r), SUBTRACT); }
+}
+
+void Region::subtract(const Region & other) {
+    if (!boxes_.empty() && !other.empty()) { combine(other, SUBTRACT); }
+}
+
+void Region::translate(const Point & ofs) {
+    for (Box & b: boxes_) {
+        b.x1 += ofs.x(); b.x2 += ofs.x();
+        b.y1 += ofs.y(); b.y2 += ofs.y();
+    }
+}
+
+bool Region::operator==(const Region & other) const {
+    if (boxes_.size() != other.boxes_.size()) { return false; }
+
+    for (std::size_t n = 0; n < boxes_.size(); ++n) {
+        const Box & a = boxes_[n], & b = other.boxes_[n];
+        if (a.x1 != b.x1 || a.y1 != b.y1 || a.x2 != b.x2 || a.y2 != b.y2) { return false; }
+    }
+
+    return true;
+}
+
+// private
+// Sweeps both regions band by band: every scanline interval between
+// consecutive band edges has constant spans in both operands.
+void Region::combine(const Region & other, int op) {
+    std::vector<int> ys;
+    ys.reserve(2*(boxes_.size()+other.boxes_.size()));
+    for (const Box & b: boxes_) { ys.push_back(b.y1); ys.push_back(b.y2); }
+    for (const Box & b: other.boxes_) { ys.push_back(b.y1); ys.push_back(b.y2); }
+    std::sort(ys.begin(), ys.end());
+    ys.erase(std::unique(ys.begin(), ys.end()), ys.end());
+
+    std::vector<Box> out;
+    Spans sa, sb, merged, prev;
+    const Box * pa = begin(), * pb = other.begin();
+    std::size_t prev_start = 0;
+    int prev_y2 = INT_MIN;
+
+    for (std::size_t n = 1; n < ys.size(); ++n) {
+        int y1 = ys[n-1], y2 = ys[n];
+        pa = band_spans(pa, end(), y1, sa);
+        pb = band_spans(pb, other.end(), y1, sb);
+        merge_spans(sa, sb, op, merged);
+        if (merged.empty()) { continue; }
+
+        // Coalesce with previous band when touching and having equal spans.
+        if (prev_y2 == y1 && merged == prev) {
+            for (std::size_t i = prev_start; i < out.size(); ++i) { out[i].y2 = y2; }
+        }
+
+        else {
+            prev_start = out.size();
+            for (auto & s: merged) { out.push_back({ s.first, y1, s.second, y2 }); }
+            prev.swap(merged);
+        }
+
+        prev_y2 = y2;
+    }
+
+    boxes_.swap(out);
+}
+
+} // namespace tau
+
+//END
@@ -0,0 +1,99 @@
+// ----------------------------------------------------------------------------
+// Copyright © 2014-2023 Konstantin Shmelkov <mrcashe@gmail.com>.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+// PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+// OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+// WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+// OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+// EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+// ----------------------------------------------------------------------------
+
+#ifndef TAU_REGION_IMPL_HH
+#define TAU_REGION_IMPL_HH
+
+#include <tau/geometry.hh>
+#include <cstdint>
+#include <vector>
+
+namespace tau {
+
+// Set of non-overlapping rectangles kept in y-x banded order:
+// the rectangles grouped into horizontal bands of equal top and bottom,
+// sorted by top and by left within band, adjacent bands having equal
+// spans are coalesced.
+class Region {
+public:
+
+    // Half open box, x2 and y2 are exclusive.
+    struct Box {
+        int x1, y1, x2, y2;
+    };
+
+    Region() = default;
+    Region(const Rect & r);
+
+    bool empty() const { return boxes_.empty(); }
+    void clear() { boxes_.clear(); }
+
+    // Number of rectangles.
+    std::size_t size() const { return boxes_.size(); }
+
+    const Box * begin() const { return boxes_.data(); }
+    const Box * end() const { return boxes_.data()+boxes_.size(); }
+
+    Rect bounds() const;
+    std::vector<Rect> rects() const;
+
+    // Covered pixel count.
+    uint64_t area() const;
+
+    bool contains(const Point & pt) const;
+    bool intersects(const Rect & r) const;
+
+    void unite(const Rect & r);
+    void unite(const Region & other);
+    void intersect(const Rect & r);
+    void intersect(const Region & other);
+    void subtract(const Rect & r);
+    void subtract(const Region & other);
+    void translate(const Point & ofs);
+
+    Region & operator|=(const Region & other) { unite(other); return *this; }
+    Region & operator&=(const Region & other) { intersect(other); return *this; }
+    Region & operator-=(const Region & other) { subtract(other); return *this; }
+
+    bool operator==(const Region & other) const;
+    bool operator!=(const Region & other) const { return !operator==(other); }
+
+    static Rect to_rect(const Box & b);
+
+private:
+
+    enum { UNION, INTERSECT, SUBTRACT };
+
+    std::vector<Box> boxes_;
+
+private:
+
+    void combine(const Region & other, int op);
+};
+
+} // namespace tau
+
+#endif // TAU_REGION_IMPL_HH
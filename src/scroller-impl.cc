@@ -27,6 +27,7 @@
 #include <tau/input.hh>
 #include <scroller-impl.hh>
 #include <theme-impl.hh>
+#include <window-impl.hh>
 #include <climits>
 #include <iostream>
 
@@ -186,8 +187,11 @@ void Scroller_impl::pan_to_y(int y) {
 
 bool Scroller_impl::update_offset(const Point & pt) {
     if (cp_) {
+        Point was(pan_);
+
         if (pan_.update(pt)) {
             signal_pan_changed_();
+            scroll_pixels(was-pan_);
             return true;
         }
     }
@@ -199,6 +203,22 @@ bool Scroller_impl::update_offset(int x, int y) {
     return update_offset(Point(x, y));
 }
 
+// Moves already painted child pixels, so only newly exposed strip gets repainted.
+// Whole area invalidated when window unable to do that.
+void Scroller_impl::scroll_pixels(const Point & delta) {
+    Rect va = obscured_area();
+
+    if (va && !cp_->hidden()) {
+        if (auto wip = window()) {
+            if (wip->winface()->scroll(va.translated(worigin()), delta)) {
+                return;
+            }
+        }
+    }
+
+    invalidate();
+}
+
 void Scroller_impl::pan_left() {
     if (pan_.x() > 0) {
         int d = std::min(step_.x(), pan_.x());
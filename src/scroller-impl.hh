@@ -95,6 +95,7 @@ private:
     void arrange();
     bool update_offset(const Point & pt);
     bool update_offset(int x, int y);
+    void scroll_pixels(const Point & delta);
 
     void pan_left();
     void pan_right();
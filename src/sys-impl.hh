@@ -34,6 +34,27 @@ namespace tau {
 
 extern Sysinfo sysinfo_;
 
+// Read-only memory mapping of the whole file, implemented by platform code.
+class File_map {
+public:
+
+    // @throw sys_error
+    explicit File_map(const ustring & path);
+   ~File_map();
+
+    File_map(const File_map & other) = delete;
+    File_map & operator=(const File_map & other) = delete;
+
+    const char * data() const { return data_; }
+    std::size_t size() const { return size_; }
+
+private:
+
+    const char *    data_ = nullptr;
+    std::size_t     size_ = 0;
+    void *          handle_ = nullptr;      // Platform specific.
+};
+
 #if (defined(__GNUC__) && (__GNUC__ >= 11)) || (defined(__clang__) && (__clang_major__ >= 15))
 
 template <class T>
@@ -0,0 +1,138 @@
+// ----------------------------------------------------------------------------
+// Copyright © 2014-2023 Konstantin Shmelkov <mrcashe@gmail.com>.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+// PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+// OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+// WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+// OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+// EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+// ----------------------------------------------------------------------------
+
+/// @file taublit.cc Large ARGB pixmap upload benchmark.
+///
+/// Runs the same test twice, each in its own thread with its own display
+/// connection: first with MIT-SHM enabled, then with MIT-SHM disabled, so
+/// every frame goes through xcb_put_image(). On each frame the whole pixmap
+/// content is replaced and the window is repainted immediately.
+///
+/// Usage: taublit [WIDTH HEIGHT [FRAMES]]
+
+#include <tau.hh>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <thread>
+
+namespace {
+
+unsigned width_ = 2048;
+unsigned height_ = 1024;
+unsigned nframes_ = 100;
+
+class Bench: public tau::Toplevel {
+public:
+
+    explicit Bench(const tau::ustring & title):
+        Toplevel(title, tau::Rect(0, 0, tau::Size(800, 600))),
+        title_(title),
+        pix_(32, width_, height_),
+        image_(pix_),
+        buffer_(4*std::size_t(width_)*height_)
+    {
+        insert(image_);
+        timer_.start(1, true);
+    }
+
+private:
+
+    tau::ustring            title_;
+    tau::Pixmap             pix_;
+    tau::Image              image_;
+    std::vector<uint8_t>    buffer_;
+    unsigned                frame_ = 0;
+    tau::Timer              timer_ { tau::fun(this, &Bench::on_timer) };
+    std::chrono::steady_clock::time_point start_;
+
+private:
+
+    void fill(unsigned n) {
+        uint32_t * p = reinterpret_cast<uint32_t *>(buffer_.data());
+
+        for (unsigned y = 0; y < height_; ++y) {
+            for (unsigned x = 0; x < width_; ++x) {
+                *p++ = 0xff000000|((x+n) & 0xff) << 16|((y+n) & 0xff) << 8|(n & 0xff);
+            }
+        }
+    }
+
+    void on_timer() {
+        // The first frame allocates server side resources and is not counted.
+        if (1 == frame_) { start_ = std::chrono::steady_clock::now(); }
+
+        if (frame_ > nframes_) {
+            timer_.stop();
+            double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now()-start_).count();
+            double mpix = double(width_)*height_*nframes_/1e6;
+            std::cout << title_ << ": " << nframes_ << " frames of " << width_ << "x" << height_
+                      << " in " << ms << " ms, " << ms/nframes_ << " ms/frame, "
+                      << (ms > 0.0 ? 1000.0*mpix/ms : 0.0) << " MPixel/s" << std::endl;
+            tau::Loop().quit();
+            return;
+        }
+
+        fill(frame_++);
+        pix_.set_argb32(tau::Point(), buffer_.data(), buffer_.size());
+        update();
+    }
+};
+
+void run(const char * args, const char * title) {
+    try {
+        tau::Display::open(args);
+        Bench wnd(title);
+        tau::Loop().run();
+    }
+
+    catch (tau::exception & x) {
+        std::cerr << "** tau::exception thrown: " << x.what() << std::endl;
+    }
+
+    catch (std::exception & x) {
+        std::cerr << "** std::exception thrown: " << x.what() << std::endl;
+    }
+}
+
+} // anonymous namespace
+
+int main(int argc, char * argv[]) {
+    if (argc > 2) {
+        width_ = std::max(1, std::atoi(argv[1]));
+        height_ = std::max(1, std::atoi(argv[2]));
+    }
+
+    if (argc > 3) {
+        nframes_ = std::max(1, std::atoi(argv[3]));
+    }
+
+    std::thread(run, "", "MIT-SHM").join();
+    std::thread(run, "noshm", "xcb_put_image").join();
+    return 0;
+}
+
+//END
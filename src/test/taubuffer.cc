@@ -0,0 +1,130 @@
+// ----------------------------------------------------------------------------
+// Copyright © 2014-2023 Konstantin Shmelkov <mrcashe@gmail.com>.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+// PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+// OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+// WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+// OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+// EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+// ----------------------------------------------------------------------------
+
+/// @file taubuffer.cc Buffer loading benchmark.
+///
+/// Loads the given text file into a Buffer using every storage mode and
+/// reports load time, resident memory growth and the time of a full pass
+/// over the text through Buffer_citer. For the mapped mode, the time until
+/// the first rows become available and the time of full indexing are
+/// reported instead of load time. Without arguments, a log-like ASCII
+/// file of about 95 MB is generated in the temporary directory.
+///
+/// Usage: taubuffer [FILE]
+
+#include <tau.hh>
+#include <chrono>
+#include <fstream>
+#include <functional>
+#include <iostream>
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+double ms_since(Clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(Clock::now()-start).count();
+}
+
+// Resident set size in MB, 0 if unknown.
+double rss_mb() {
+    std::ifstream is("/proc/self/statm");
+    std::size_t vm = 0, rss = 0;
+    is >> vm >> rss;
+    return rss*4096.0/1048576.0;
+}
+
+tau::ustring generate() {
+    tau::ustring path = tau::path_build(tau::path_tmp(), "taubuffer.log");
+    std::ofstream os(path, std::ios::binary);
+
+    for (unsigned i = 0; i < 1000000; ++i) {
+        os << "2023-01-01 12:00:00.000 [" << i%16 << "] INFO tau::Buffer: loading line number " << i << ", nothing happens here" << std::endl;
+    }
+
+    return path;
+}
+
+void bench(const tau::ustring & path, int flags, const char * title) {
+    double rss = rss_mb();
+    auto start = Clock::now();
+    tau::Buffer buf = tau::Buffer::load_from_file(path, flags);
+    double ms = ms_since(start);
+    std::cout << title << ": " << buf.rows() << " rows, " << buf.size() << " chars, load " << ms << " ms, memory " << rss_mb()-rss << " MB" << std::endl;
+
+    start = Clock::now();
+    char32_t sum = 0;
+    for (auto i = buf.cbegin(); !i.eof(); ++i) { sum += *i; }
+    std::cout << title << ": iterate " << ms_since(start) << " ms (" << sum << ")" << std::endl;
+}
+
+void bench_mapped(const tau::ustring & path) {
+    double rss = rss_mb(), first = 0;
+    auto start = Clock::now();
+    tau::Buffer buf = tau::Buffer::load_from_file(path, tau::BUFFER_MAPPED);
+    std::cout << "mapped: open " << ms_since(start) << " ms" << std::endl;
+    tau::Loop loop;
+
+    buf.signal_progress().connect(tau::fun(std::function<void(std::size_t, std::size_t)>([&](std::size_t indexed, std::size_t total) {
+        if (0 == first) { first = ms_since(start); }
+        if (indexed == total) { loop.quit(); }
+    })));
+
+    if (buf.indexing()) { loop.run(); }
+    double ms = ms_since(start);
+    std::cout << "mapped: " << buf.rows() << " rows, " << buf.size() << " chars, first rows " << first << " ms, indexed " << ms << " ms, memory " << rss_mb()-rss << " MB" << std::endl;
+
+    start = Clock::now();
+    char32_t sum = 0;
+    for (auto i = buf.cbegin(); !i.eof(); ++i) { sum += *i; }
+    std::cout << "mapped: iterate " << ms_since(start) << " ms (" << sum << ")" << std::endl;
+}
+
+} // anonymous namespace
+
+int main(int argc, char * argv[]) {
+    try {
+        tau::ustring path = argc > 1 ? tau::ustring(argv[1]) : generate();
+        std::cout << "file: " << path << ", " << tau::Fileinfo(path).bytes() << " bytes" << std::endl;
+        bench_mapped(path);
+        bench(path, tau::BUFFER_COMPACT, "compact");
+        bench(path, tau::BUFFER_DEFAULT, "default");
+    }
+
+    catch (tau::exception & x) {
+        std::cerr << "** tau::exception thrown: " << x.what() << std::endl;
+        return 1;
+    }
+
+    catch (std::exception & x) {
+        std::cerr << "** std::exception thrown: " << x.what() << std::endl;
+        return 1;
+    }
+
+    return 0;
+}
+
+//END
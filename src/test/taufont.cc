@@ -0,0 +1,98 @@
+// ----------------------------------------------------------------------------
+// Copyright © 2014-2023 Konstantin Shmelkov <mrcashe@gmail.com>.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+// PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+// OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+// WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+// OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+// EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+// ----------------------------------------------------------------------------
+
+/// @file taufont.cc Glyph loading benchmark.
+///
+/// Loads every glyph of the Basic Multilingual Plane from the given font
+/// through a pixmap painter, so no display connection is needed. Reports
+/// the time spent by font registry setup, font opening, the first pass
+/// (glyphs read from the font file) and the second pass (cached glyphs).
+///
+/// Usage: taufont [FONT_SPEC]
+
+#include <tau.hh>
+#include <chrono>
+#include <iostream>
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+double ms_since(Clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(Clock::now()-start).count();
+}
+
+unsigned load_all(tau::Font & font) {
+    unsigned n = 0;
+
+    for (char32_t wc = 0x0020; wc < 0x10000; ++wc) {
+        if (!tau::char16_is_surrogate(char16_t(wc)) && font.glyph(wc)) { ++n; }
+    }
+
+    return n;
+}
+
+} // anonymous namespace
+
+int main(int argc, char * argv[]) {
+    tau::ustring spec = argc > 1 ? tau::ustring(argv[1]) : tau::ustring("DejaVu Sans 10");
+
+    try {
+        auto start = Clock::now();
+        tau::Font::normal();
+        std::cout << "font registry: " << ms_since(start) << " ms" << std::endl;
+
+        tau::Pixmap pix(32, 16, 16);
+        tau::Painter pr = pix.painter();
+        start = Clock::now();
+        tau::Font font = pr.select_font(spec);
+        std::cout << "open " << font.spec() << ": " << ms_since(start) << " ms" << std::endl;
+
+        start = Clock::now();
+        unsigned n = load_all(font);
+        double ms = ms_since(start);
+        std::cout << "first pass: " << n << " glyphs in " << ms << " ms, " << (n ? 1000.0*ms/n : 0.0) << " us/glyph" << std::endl;
+
+        start = Clock::now();
+        n = load_all(font);
+        ms = ms_since(start);
+        std::cout << "second pass: " << n << " glyphs in " << ms << " ms, " << (n ? 1000.0*ms/n : 0.0) << " us/glyph" << std::endl;
+    }
+
+    catch (tau::exception & x) {
+        std::cerr << "** tau::exception thrown: " << x.what() << std::endl;
+        return 1;
+    }
+
+    catch (std::exception & x) {
+        std::cerr << "** std::exception thrown: " << x.what() << std::endl;
+        return 1;
+    }
+
+    return 0;
+}
+
+//END
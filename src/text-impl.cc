@@ -30,16 +30,23 @@
 #include <tau/painter.hh>
 #include <tau/string.hh>
 #include <display-impl.hh>
+#include <font-impl.hh>
 #include <loop-impl.hh>
 #include <painter-impl.hh>
 #include <scroller-impl.hh>
 #include <text-impl.hh>
+#include <theme-impl.hh>
 #include <iostream>
 
 namespace tau {
 
 static const unsigned CARET_TIMEOUT = 511;
 
+// Buffers having up to LAYOUT_ROWS rows are laid out at once, larger ones only
+// within visible area. Layouts of rows far from visible area are dropped when
+// count of laid out rows exceeds LAYOUT_ROWS.
+static const std::size_t LAYOUT_ROWS = 4096;
+
 Text_impl::Text_impl():
     Widget_impl(),
     caret_visible_(false),
@@ -146,10 +153,14 @@ bool Text_impl::empty() const {
 
 void Text_impl::update_font() {
     if (auto pr = priv_painter()) {
+        fonts_.resize(1);
+        fallbacks_.clear();
         fonts_.front() = pr.select_font(style_.font(STYLE_FONT).spec());
+        reset_rows();
 
         if (fonts_.front()) {
-            font_height_ = std::ceil(fonts_.front().ascent())+std::ceil(std::fabs(fonts_.front().descent()));
+            font_ascent_ = std::ceil(fonts_.front().ascent());
+            font_height_ = font_ascent_+std::ceil(std::fabs(fonts_.front().descent()));
             space_width_ = std::ceil(pr.text_size(U" ").x());
         }
     }
@@ -276,9 +287,11 @@ void Text_impl::on_buffer_erase(Buffer_citer b, Buffer_citer e, const std::u32st
     else {
         auto j = rows_.begin()+e.row();
         int hdel = calc_height(i+1, j);
+        for (auto k = i; k != j; ++k) { drop_layout(k); }
         rows_.erase(i, j);
         translate_rows(i, rows_.end(), -hdel);
-        load_rows(i, j);
+        drop_layout(i);
+        i->estimated_ = true;
         calc_rows();
         e = buffer_.cend();
         wipe_area(va_.x(), i->ybase_-i->ascent_, va_.right(), va_.bottom());
@@ -300,16 +313,24 @@ void Text_impl::on_buffer_insert(Buffer_citer b, Buffer_citer e) {
 }
 
 void Text_impl::on_buffer_insert_move(Buffer_citer b, Buffer_citer e) {
-    move_to(e);
-    hint_x();
+    // Locked buffer grows while being indexed, caret stays.
+    if (!buffer_.locked()) {
+        move_to(e);
+        hint_x();
+    }
 }
 
 void Text_impl::insert_range(Buffer_citer b, Buffer_citer e) {
     if (rows_.empty()) { rows_.emplace_back(); }
     if (e < b) { std::swap(b, e); }
-    std::size_t nlines = e.row()-b.row();
-    while (nlines--) { rows_.emplace(rows_.begin()+b.row()); }
-    load_rows(rows_.begin()+b.row(), rows_.begin()+e.row());
+    rows_.insert(rows_.begin()+b.row(), e.row()-b.row(), Row());
+
+    // The first and the last rows changed, the rest are new.
+    for (auto i: { rows_.begin()+b.row(), rows_.begin()+e.row() }) {
+        drop_layout(i);
+        i->estimated_ = true;
+    }
+
     if (e.row() > b.row()) { e = buffer_.cend(); }
     if (ALIGN_START != xalign_) { b.move_to_sol(); e.move_to_eol(); }
     calc_rows();
@@ -342,6 +363,7 @@ void Text_impl::clear() {
 
     buffer_.clear();
     rows_.clear();
+    nlaid_ = 0;
     sel_.reset();
     esel_.reset();
     msel_.reset();
@@ -504,16 +526,78 @@ void Text_impl::update_range(Buffer_citer b, Buffer_citer e) {
 
 void Text_impl::load_rows(R_iter first, R_iter last) {
     for (; first != rows_.end() && first <= last; ++first) {
+        if (first->frags_.empty()) { ++nlaid_; }
         first->frags_.clear();
         auto rn = first-rows_.begin();
         auto b = buffer_.citer(rn, 0), e = b; e.move_to_eol();
         first->ncols_ = b.length(e);
         first->poss_.assign(first->ncols_, 0);
+        std::size_t start = 0;
+        int font = 0;
+
+        // Split row into fragments using the same font.
+        if (fonts_.front()) {
+            std::u32string s = buffer_.text32(b, e);
+
+            for (std::size_t col = 0; col < s.size(); ++col) {
+                int f = font_index(s[col], font);
+
+                if (f != font) {
+                    if (col > start) {
+                        first->frags_.emplace_back();
+                        Frag & frag = first->frags_.back();
+                        frag.start_ = start;
+                        frag.ncols_ = col-start;
+                        frag.font_ = font;
+                        start = col;
+                    }
+
+                    font = f;
+                }
+            }
+        }
+
         first->frags_.emplace_back();
         Frag & frag = first->frags_.back();
-        frag.start_ = 0;
-        frag.ncols_ = first->ncols_;
+        frag.start_ = start;
+        frag.ncols_ = first->ncols_-start;
+        frag.font_ = font;
+    }
+}
+
+// Returns index of the font for the character within fonts_.
+// Spaces and combining characters stay with the current font cur.
+int Text_impl::font_index(char32_t wc, int cur) {
+    if (wc < 0x0080) { return 0x0020 == wc || 0x0009 == wc ? cur : 0; }
+    Font_ptr fp = Font_impl::strip(fonts_.front());
+    if (!fp || fp->has_glyph(wc)) { return 0; }
+    auto i = fallbacks_.find(wc);
+    if (i != fallbacks_.end()) { return i->second; }
+    if (char32_is_modifier(wc) || char32_is_zerowidth(wc)) { return cur; }
+    int index = 0;
+    ustring spec = Theme_impl::root()->font_fallback(fonts_.front().spec(), wc);
+
+    if (!spec.empty()) {
+        for (std::size_t n = 1; 0 == index && n < fonts_.size(); ++n) {
+            if (str_similar(spec, fonts_[n].spec())) { index = n; }
+        }
+
+        if (0 == index) {
+            if (Painter pr = priv_painter()) {
+                pr.push();
+                Font font = pr.select_font(spec);
+                pr.pop();
+
+                if (font) {
+                    fonts_.push_back(font);
+                    index = fonts_.size()-1;
+                }
+            }
+        }
     }
+
+    fallbacks_[wc] = index;
+    return index;
 }
 
 void Text_impl::calc_row(R_iter i, Painter pr) {
@@ -528,40 +612,68 @@ void Text_impl::calc_row(R_iter i, Painter pr) {
         std::size_t pos = 0;
         auto rn = i-rows_.begin();
         auto b = buffer_.citer(rn, 0), e = b; b.move_to_col(i->ncols_);
-        std::u32string s = buffer_.text32(b, e);
+        std::u32string s;
+        bool measured = true;
+
+        for (const Frag & frag: i->frags_) {
+            if (!frag.mfont_ || frag.mfont_ != fonts_[frag.font_]) {
+                measured = false;
+                break;
+            }
+        }
+
+        if (!measured) { s = buffer_.text32(b, e); }
 
         for (Frag & frag: i->frags_) {
             Font font = fonts_[frag.font_];
-            pr.set_font(font);
             i->ascent_ = std::max(i->ascent_, int(std::ceil(font.ascent())));
             i->descent_ = std::max(i->descent_, int(std::ceil(fabs(font.descent()))));
-            std::u32string acc;
 
-            for (std::size_t j = 0; j < frag.ncols_; ++j) {
-                i->poss_[j+frag.start_] = x+std::ceil(pr.text_size(acc).x());
-                char32_t c = s[j+frag.start_];
+            // Positions kept from previous call while row and fonts unchanged.
+            if (!measured) {
+                pr.set_font(font);
+                mstr_.clear();
+
+                // Expand tabs, poss_ temporary holds character offsets within mstr_.
+                for (std::size_t j = 0; j < frag.ncols_; ++j) {
+                    i->poss_[j+frag.start_] = mstr_.size();
+                    char32_t c = s[j+frag.start_];
 
-                if (0x0009 == c) {
-                    std::size_t n_spaces = tab_width_-(pos%tab_width_);
-                    acc.append(n_spaces, U' ');
-                    pos += n_spaces;
+                    if (0x0009 == c) {
+                        std::size_t n_spaces = tab_width_-(pos%tab_width_);
+                        mstr_.append(n_spaces, U' ');
+                        pos += n_spaces;
+                    }
+
+                    else {
+                        mstr_.append(1, c);
+                        ++pos;
+                    }
                 }
 
-                else {
-                    acc.append(1, c);
-                    ++pos;
+                frag.width_ = std::ceil(pr.text_size(mstr_, madvs_).x());
+
+                for (std::size_t j = 0; j < frag.ncols_; ++j) {
+                    int & p = i->poss_[j+frag.start_];
+                    p = x+(0 != p ? madvs_[p-1] : 0);
                 }
+
+                frag.mfont_ = font;
             }
 
-            frag.width_ = std::ceil(pr.text_size(acc).x());
             x += frag.width_;
         }
 
+        // Leave the primary font selected.
+        if (!measured && 1 < i->frags_.size()) { pr.set_font(fonts_.front()); }
+
         i->width_ = x;
+        i->estimated_ = false;
         i->ellipsized_.clear();
 
         if (0 != ellipsis_width_ && va_.iwidth() >= ellipsis_width_ && i->ncols_ > 1) {
             if (i->width_ > va_.iwidth()) {
+                if (measured) { s = buffer_.text32(b, e); }
                 std::size_t col = 1;
                 int w = va_.width()-ellipsis_width_;
 
@@ -617,7 +729,8 @@ void Text_impl::calc_rows() {
     auto pr = priv_painter();
 
     for (auto i = rows_.begin(); i != rows_.end(); ++i) {
-        calc_row(i, pr);
+        if (!i->frags_.empty()) { calc_row(i, pr); }
+        else if (i->estimated_) { i->ascent_ = font_ascent_; i->descent_ = font_height_-font_ascent_; }
         i->ybase_ = ybase+i->ascent_;
         ybase += i->ascent_+i->descent_+spacing_;
         text_height_ += i->ascent_+i->descent_;
@@ -625,10 +738,110 @@ void Text_impl::calc_rows() {
         text_width_ = std::max(text_width_, i->width_);
     }
 
+    layout_visible();
     update_requisition();
     align_all();
 }
 
+// Lays out rows within range, the following rows moved on height change.
+// Returns true if vertical geometry changed.
+bool Text_impl::layout_rows(std::size_t first, std::size_t last) {
+    Painter pr = priv_painter();
+    if (!pr || first >= rows_.size()) { return false; }
+    last = std::min(last, rows_.size()-1);
+    int dy = 0, oy = oy_, width = text_width_;
+    bool loaded = false;
+
+    for (auto i = rows_.begin()+first, e = rows_.begin()+last; i <= e; ++i) {
+        i->ybase_ += dy;
+
+        if (i->frags_.empty()) {
+            int ascent = i->ascent_, height = ascent+i->descent_;
+            load_rows(i, i);
+            calc_row(i, pr);
+            i->ybase_ += i->ascent_-ascent;
+            dy += i->ascent_+i->descent_-height;
+            text_width_ = std::max(text_width_, i->width_);
+            loaded = true;
+        }
+    }
+
+    if (loaded) {
+        if (0 != dy) {
+            if (last+1 < rows_.size()) { translate_rows(rows_.begin()+last+1, rows_.end(), dy); }
+            text_height_ += dy;
+        }
+
+        if (0 != dy || width != text_width_) { update_requisition(); }
+        align_rows(rows_.begin()+first, rows_.begin()+last);
+    }
+
+    return 0 != dy || oy != oy_;
+}
+
+// Gets range [first, last) of rows within visible area.
+void Text_impl::visible_rows(std::size_t & first, std::size_t & last) const {
+    int top = va_.top(), bottom = va_.bottom();
+    auto b = std::partition_point(rows_.begin(), rows_.end(), [this, top](auto & row) { return oy_+row.ybase_+row.descent_ < top; } );
+    auto e = std::partition_point(b, rows_.end(), [this, bottom](auto & row) { return oy_+row.ybase_-row.ascent_ <= bottom; } );
+    first = b-rows_.begin();
+    last = e-rows_.begin();
+}
+
+void Text_impl::layout_visible() {
+    std::size_t nrows = rows_.size();
+    bool changed = false;
+
+    if (!va_ || nrows <= LAYOUT_ROWS) {
+        changed = layout_rows(0, LAYOUT_ROWS-1);
+    }
+
+    else {
+        // Measured heights may differ from estimated ones, so the visible range may change.
+        for (std::size_t first, last; ; changed = true) {
+            visible_rows(first, last);
+            if (first == last || !layout_rows(first, last-1)) { break; }
+        }
+
+        if (caret_ && caret_.row() < nrows && layout_rows(caret_.row(), caret_.row())) { changed = true; }
+        if (nlaid_ > LAYOUT_ROWS) { evict_rows(); }
+    }
+
+    if (changed) { invalidate(); }
+}
+
+// Drops layout but keeps metrics.
+void Text_impl::drop_layout(R_iter i) {
+    if (!i->frags_.empty()) {
+        Frags().swap(i->frags_);
+        Poss().swap(i->poss_);
+        std::u32string().swap(i->ellipsized_);
+        i->ncols_ = 0;
+        --nlaid_;
+    }
+}
+
+// Drops layouts and metrics of all rows.
+void Text_impl::reset_rows() {
+    for (auto i = rows_.begin(); i != rows_.end(); ++i) {
+        drop_layout(i);
+        i->estimated_ = true;
+    }
+}
+
+// Drops layouts of rows far from visible area, keeps the caret row.
+void Text_impl::evict_rows() {
+    std::size_t first, last, margin = LAYOUT_ROWS/4, crow = caret_ ? caret_.row() : rows_.size();
+    visible_rows(first, last);
+    first = first > margin ? first-margin : 0;
+    last += margin;
+
+    for (auto i = rows_.begin(); i != rows_.end(); ++i) {
+        std::size_t ri = i-rows_.begin();
+        if ((ri < first || ri >= last) && ri != crow) { drop_layout(i); }
+    }
+}
+
 int Text_impl::calc_height(R_citer first, R_citer last) {
     if (last < first) { std::swap(first, last); }
     int h = 0;
@@ -658,6 +871,7 @@ void Text_impl::update_caret() {
 
     if (!buffer_.empty()) {
         if (caret_.row() < rows_.size()) {
+            layout_rows(caret_.row(), caret_.row());
             const Row & row = rows_[caret_.row()];
             x1 = x_at_col(row, caret_.col());
             y1 += row.ybase_-row.ascent_;
@@ -741,6 +955,7 @@ void Text_impl::wipe_caret() {
 
 void Text_impl::scroll_to_caret() {
     if (caret_enabled_ && !buffer_.empty() && caret_.row() < rows_.size() && va_) {
+        layout_rows(caret_.row(), caret_.row());
         Point ofs(va_.origin());
         const Row & row = rows_[caret_.row()];
         int y1 = oy_+row.ybase_-row.ascent_;
@@ -840,6 +1055,7 @@ std::size_t Text_impl::hinted_pos(std::size_t ri) {
     int x1 = 0;
 
     if (xhint_ > 0 && ri < rows_.size()) {
+        layout_rows(ri, ri);
         auto & row = rows_[ri];
 
         for (std::size_t n = 1; n < row.ncols_; ++n) {
@@ -867,8 +1083,9 @@ int Text_impl::x_at_col(const Row & row, std::size_t col) const {
     return row.ox_+(col < row.ncols_ ? row.poss_[col] : row.width_);
 }
 
-int Text_impl::x_at_col(std::size_t ri, std::size_t col) const {
+int Text_impl::x_at_col(std::size_t ri, std::size_t col) {
     if (ri < rows_.size()) {
+        layout_rows(ri, ri);
         return x_at_col(rows_[ri], col);
     }
 
@@ -896,8 +1113,9 @@ std::size_t Text_impl::col_at_x(const Row & row, int x) const {
     return col;
 }
 
-std::size_t Text_impl::col_at_x(std::size_t ri, int x) const {
+std::size_t Text_impl::col_at_x(std::size_t ri, int x) {
     if (ri < rows_.size()) {
+        layout_rows(ri, ri);
         return col_at_x(rows_[ri], x);
     }
 
@@ -906,7 +1124,7 @@ std::size_t Text_impl::col_at_x(std::size_t ri, int x) const {
 
 std::size_t Text_impl::row_at_y(int y) const {
     if (!rows_.empty() && y >= 0) {
-        auto i = std::find_if(rows_.begin(), rows_.end(), [y](auto & row) { return row.ybase_+row.descent_ >= y; } );
+        auto i = std::partition_point(rows_.begin(), rows_.end(), [y](auto & row) { return row.ybase_+row.descent_ < y; } );
         if (i != rows_.end()) { return i-rows_.begin(); }
         return rows_.size()-1;
     }
@@ -970,20 +1188,22 @@ void Text_impl::paint_row(R_citer ri, std::size_t pos, Painter pr) {
     int y1 = ybase-ri->ascent_;
     int y2 = ybase+ri->descent_;
 
+    auto b = buffer_.citer(rn, 0), e = buffer_.citer(rn, ri->ncols_);
+    const std::u32string s = buffer_.text32(b, e);
+
     // Loop over fragmens.
     for (const Frag & frag: ri->frags_) {
         std::size_t fend = col0+frag.ncols_;
         std::size_t col = std::max(scol, col0);
 
         if (fend > scol) {
-            auto b = buffer_.citer(rn, 0), e = buffer_.citer(rn, ri->ncols_);
-            const std::u32string s = buffer_.text32(b, e);
             std::size_t col1 = std::min(ecol, fend);
 
             // Loop inside of fragment.
             while (col < col1) {
                 std::size_t col2 = col1;
-                select_font(pr);
+                if (0 != frag.font_ && fonts_[frag.font_]) { pr.set_font(fonts_[frag.font_]); }
+                else { select_font(pr); }
 
                 if (sel_ && esel_) {
                     if (sel_.row() == rn && col < sel_.col()) {
@@ -1018,7 +1238,7 @@ void Text_impl::paint_row(R_citer ri, std::size_t pos, Painter pr) {
                         Color c = enabled() ? style_.color(STYLE_FOREGROUND) : style_.color(STYLE_BACKGROUND).get().inactive();
                         auto ppr = strip(pr);
                         ppr->move_to(x1, ybase);
-                        ppr->text(s.substr(col-col0, col2-col), c);
+                        ppr->text(s.substr(col, col2-col), c);
                         ppr->stroke();
                         col += col2-col;
                     }
@@ -1051,8 +1271,18 @@ void Text_impl::redraw(const Rect & r, Painter pr) {
         wipe_caret();
         pr.push();
 
-        R_iter b = std::find_if(rows_.begin(), rows_.end(), [r](auto & row) { return row.ybase_+row.descent_ >= r.top(); } );
-        R_iter e = std::find_if(b, rows_.end(), [r](auto & row) { return row.ybase_-row.ascent_ > r.bottom(); } );
+        R_iter b, e;
+        bool moved = false;
+
+        // Rows not laid out yet may change their height after measurement.
+        for (;;) {
+            b = std::partition_point(rows_.begin(), rows_.end(), [r](auto & row) { return row.ybase_+row.descent_ < r.top(); } );
+            e = std::partition_point(b, rows_.end(), [r](auto & row) { return row.ybase_-row.ascent_ <= r.bottom(); } );
+            if (b == e || !layout_rows(b-rows_.begin(), e-rows_.begin()-1)) { break; }
+            moved = true;
+        }
+
+        if (moved) { invalidate(); }
 
         for (; b != e && b != rows_.end(); ++b) {
             if (!b->ellipsized_.empty()) { paint_ellipsized(*b, pr); }
@@ -1546,6 +1776,7 @@ bool Text_impl::on_take_focus() {
 
 void Text_impl::update_va() {
     va_ = visible_area();
+    layout_visible();
 }
 
 void Text_impl::init_actions() {
@@ -35,6 +35,7 @@
 #include <tau/font.hh>
 #include <tau/painter.hh>
 #include <widget-impl.hh>
+#include <unordered_map>
 
 namespace tau {
 
@@ -86,8 +87,8 @@ public:
     void enable_caret();
     void disable_caret();
 
-    int x_at_col(std::size_t ri, std::size_t col) const;
-    std::size_t col_at_x(std::size_t ri, int x) const;
+    int x_at_col(std::size_t ri, std::size_t col);
+    std::size_t col_at_x(std::size_t ri, int x);
     std::size_t row_at_y(int y) const;
     int baseline(std::size_t ri) const;
     void get_row_bounds(std::size_t ri, int & top, int & bottom) const;
@@ -226,6 +227,7 @@ private:
         std::size_t     ncols_      = 0;
         int             width_      = 0;
         int             font_       = 0;
+        Font            mfont_;                     // Font used for measurement, empty if not measured yet.
     };
 
     // Fragments.
@@ -235,6 +237,8 @@ private:
     using Poss  = std::vector<int>;
 
     // Row structure.
+    // Rows are laid out lazily: row without fragments has no layout, its metrics
+    // are either estimated or kept from the last measurement.
     struct Row {
         std::size_t     ncols_      = 0;            // Number of columns (characters).
         int             width_      = 0;            // Width in pixels.
@@ -242,6 +246,7 @@ private:
         int             descent_    = 0;            // Descent in pixels.
         int             ybase_      = 0;            // Baseline within entire widget area.
         int             ox_         = 0;            // Offset within X coordinate.
+        bool            estimated_  = true;         // Metrics are estimated, row never measured.
         std::u32string  ellipsized_;
         Frags           frags_;
         Poss            poss_;
@@ -261,8 +266,12 @@ private:
     bool                caret_enabled_:  1;
     bool                select_allowed_: 1;
 
-    std::vector<Font>   fonts_;
+    std::vector<Font>   fonts_;                     // The first one is the primary font, others are fallback fonts.
+    std::unordered_map<char32_t, int> fallbacks_;   // Characters missing in the primary font -> index within fonts_.
+    std::u32string      mstr_;                      // Row text with tabs expanded, used by calc_row().
+    std::vector<int>    madvs_;                     // Cumulative advances of mstr_.
     int                 xhint_ = 0;                 // Desired x offset for up/down caret navigation.
+    int                 font_ascent_ = 0;           // Primary font ascent, used for estimated row metrics.
     int                 font_height_ = 0;
     int                 text_width_ = 0;
     int                 tab_width_ = 8;
@@ -270,6 +279,7 @@ private:
     int                 ellipsis_width_ = 0;
     int                 text_height_ = 0;
     int                 oy_ = 0;                    // Vertical offset.
+    std::size_t         nlaid_ = 0;                 // Count of rows having layout.
     Rect                va_;                        // Visible area.
     Rect                rcaret_;                    // Caret rectangle.
     Color               ccaret_;                    // Caret color.
@@ -308,9 +318,16 @@ private:
     int  calc_width(R_citer first, R_citer last);
     void calc_row(R_iter i, Painter pr=Painter());
     void calc_rows();
+    bool layout_rows(std::size_t first, std::size_t last);
+    void layout_visible();
+    void visible_rows(std::size_t & first, std::size_t & last) const;
+    void drop_layout(R_iter i);
+    void reset_rows();
+    void evict_rows();
     bool align_rows(R_iter first, R_iter last);
     void align_all();
     void load_rows(R_iter first, R_iter last);
+    int  font_index(char32_t wc, int cur);
     void translate_rows(R_iter first, R_iter last, int dy);
     void insert_range(Buffer_citer b, Buffer_citer e);
     void paint_row(R_citer ri, std::size_t pos, Painter pr);
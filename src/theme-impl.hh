@@ -78,6 +78,11 @@ public:
     ustring font_normal() { return font_normal_; }
     ustring font_mono() { return font_mono_; }
 
+    // Returns spec of the font having glyph for the character, preferring
+    // the face of given spec, or empty string if no font has the glyph.
+    // Overridden by Theme_posix.
+    virtual ustring font_fallback(const ustring & spec, char32_t wc) { return ustring(); }
+
     Master_action * find_action(const std::string & name);
     void init_window_style(Style & st);
     void init_style(Style & st);
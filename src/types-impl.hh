@@ -149,6 +149,9 @@ class Painter_impl;
 using Painter_impl_ptr = std::shared_ptr<Painter_impl>;
 using Painter_impl_cptr = std::shared_ptr<const Painter_impl>;
 
+struct Display_list;
+using Display_list_ptr = std::shared_ptr<Display_list>;
+
 class Roller_impl;
 using Roller_ptr = std::shared_ptr<Roller_impl>;
 using Roller_cptr = std::shared_ptr<const Roller_impl>;
@@ -25,6 +25,7 @@
 // ----------------------------------------------------------------------------
 
 #include <tau/exception.hh>
+#include <utf-impl.hh>
 #include <algorithm>
 #include <cstdlib>
 #include <cstring>
@@ -360,9 +361,7 @@ ustring::ustring(std::string && src):
 }
 
 ustring::ustring(const std::u32string & src) {
-    for (const char32_t * p = src.c_str(); *p; ++p) {
-        push_back(*p);
-    }
+    utf8_encode(src.c_str(), std::char_traits<char32_t>::length(src.c_str()), str_);
 }
 
 ustring::ustring(const std::u16string & ws) {
@@ -1183,12 +1182,23 @@ ustring::operator std::u16string() const {
 }
 
 ustring::operator std::u32string() const {
-    std::u32string ws;
-
-    for (const char * p = str_.c_str(); '\0' != *p; p = utf8_next(p)) {
-        ws.push_back(char32_from_pointer(p));
+    const char * p = str_.c_str(), * end = p+std::strlen(p);
+    std::u32string ws(end-p, U'\0');
+    std::size_t n = 0;
+
+    while (p < end) {
+        std::size_t nchars;
+        p += utf8_decode(p, end-p, &ws[n], nchars);
+        n += nchars;
+
+        // Malformed sequence.
+        if (p < end) {
+            ws[n++] = char32_from_pointer(p);
+            p = std::min(utf8_next(p), end);
+        }
     }
 
+    ws.resize(n);
     return ws;
 }
 
@@ -0,0 +1,433 @@
+// ----------------------------------------------------------------------------
+// Copyright © 2014-2023 Konstantin Shmelkov <mrcashe@gmail.com>.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+// PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+// OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+// WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+// OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+// EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+// ----------------------------------------------------------------------------
+
+#include <tau/string.hh>
+#include <utf-impl.hh>
+#include <algorithm>
+#include <cstring>
+
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__)) && defined(__SSE2__)
+#define TAU_UTF_X86 1
+#include <immintrin.h>
+#else
+#define TAU_UTF_X86 0
+#endif
+
+namespace {
+
+inline char16_t utf16_unit(const char * p, bool be) {
+    return be ? char16_t((uint8_t(p[0]) << 8) | uint8_t(p[1])) : char16_t((uint8_t(p[1]) << 8) | uint8_t(p[0]));
+}
+
+inline char32_t utf32_unit(const char * p, bool be) {
+    return be ? (char32_t(uint8_t(p[0])) << 24) | (char32_t(uint8_t(p[1])) << 16) | (char32_t(uint8_t(p[2])) << 8) | uint8_t(p[3])
+              : (char32_t(uint8_t(p[3])) << 24) | (char32_t(uint8_t(p[2])) << 16) | (char32_t(uint8_t(p[1])) << 8) | uint8_t(p[0]);
+}
+
+inline bool is_newline(char32_t wc) {
+    return 0x000a == wc || 0x000d == wc || 0x2028 == wc || 0x2029 == wc;
+}
+
+// The scalar versions, also used for the tails.
+// Each widen_xxx() function converts leading run of characters which need no further
+// processing and returns its length, the run may stop before the first character
+// needing attention.
+
+std::size_t widen_ascii_scalar(const char * src, std::size_t n, char32_t * dst) {
+    std::size_t i = 0;
+
+    for (uint64_t w; i+8 <= n; i += 8) {
+        std::memcpy(&w, src+i, 8);
+        if (0 != (w & 0x8080808080808080ULL)) { break; }
+        for (std::size_t j = 0; j < 8; ++j) { dst[i+j] = uint8_t(src[i+j]); }
+    }
+
+    return i;
+}
+
+std::size_t widen_utf16_scalar(const char * src, std::size_t n, bool be, char32_t * dst) {
+    std::size_t i = 0;
+
+    for (; i < n; ++i) {
+        char16_t u = utf16_unit(src+i+i, be);
+        if (0xd800 == (0xf800 & u)) { break; }
+        dst[i] = u;
+    }
+
+    return i;
+}
+
+std::size_t widen_utf32_scalar(const char * src, std::size_t n, bool be, char32_t * dst) {
+    for (std::size_t i = 0; i < n; ++i) { dst[i] = utf32_unit(src+4*i, be); }
+    return n;
+}
+
+std::size_t narrow_ascii_scalar(const char32_t * src, std::size_t n, char * dst) {
+    std::size_t i = 0;
+    for (; i < n && src[i] < 0x80; ++i) { dst[i] = char(src[i]); }
+    return i;
+}
+
+std::size_t ascii_run_scalar(const char * src, std::size_t n) {
+    std::size_t i = 0;
+
+    for (; i < n; ++i) {
+        char c = src[i];
+        if ((0x80 & c) || '\n' == c || '\r' == c) { break; }
+    }
+
+    return i;
+}
+
+std::size_t find_newline_scalar(const char32_t * src, std::size_t n) {
+    std::size_t i = 0;
+    while (i < n && !is_newline(src[i])) { ++i; }
+    return i;
+}
+
+#if TAU_UTF_X86
+
+inline unsigned ctz(unsigned m) {
+    return __builtin_ctz(m);
+}
+
+// Widens 16 bytes into 16 characters.
+inline void widen16_sse2(__m128i v, char32_t * dst) {
+    const __m128i zero = _mm_setzero_si128();
+    __m128i lo = _mm_unpacklo_epi8(v, zero), hi = _mm_unpackhi_epi8(v, zero);
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(dst), _mm_unpacklo_epi16(lo, zero));
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(dst+4), _mm_unpackhi_epi16(lo, zero));
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(dst+8), _mm_unpacklo_epi16(hi, zero));
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(dst+12), _mm_unpackhi_epi16(hi, zero));
+}
+
+inline __m128i bswap16_sse2(__m128i v) {
+    return _mm_or_si128(_mm_slli_epi16(v, 8), _mm_srli_epi16(v, 8));
+}
+
+std::size_t widen_ascii_sse2(const char * src, std::size_t n, char32_t * dst) {
+    std::size_t i = 0;
+
+    for (; i+16 <= n; i += 16) {
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src+i));
+        if (0 != _mm_movemask_epi8(v)) { break; }
+        widen16_sse2(v, dst+i);
+    }
+
+    return i;
+}
+
+std::size_t widen_utf16_sse2(const char * src, std::size_t n, bool be, char32_t * dst) {
+    const __m128i zero = _mm_setzero_si128(), mask = _mm_set1_epi16(short(0xf800)), sur = _mm_set1_epi16(short(0xd800));
+    std::size_t i = 0;
+
+    for (; i+8 <= n; i += 8) {
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src+i+i));
+        if (be) { v = bswap16_sse2(v); }
+        if (0 != _mm_movemask_epi8(_mm_cmpeq_epi16(_mm_and_si128(v, mask), sur))) { break; }
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(dst+i), _mm_unpacklo_epi16(v, zero));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(dst+i+4), _mm_unpackhi_epi16(v, zero));
+    }
+
+    return i;
+}
+
+std::size_t widen_utf32_sse2(const char * src, std::size_t n, bool be, char32_t * dst) {
+    std::size_t i = 0;
+
+    for (; i+4 <= n; i += 4) {
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src+4*i));
+
+        if (be) {
+            v = bswap16_sse2(v);
+            v = _mm_or_si128(_mm_slli_epi32(v, 16), _mm_srli_epi32(v, 16));
+        }
+
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(dst+i), v);
+    }
+
+    return i;
+}
+
+std::size_t narrow_ascii_sse2(const char32_t * src, std::size_t n, char * dst) {
+    const __m128i high = _mm_set1_epi32(~0x7f), zero = _mm_setzero_si128();
+    std::size_t i = 0;
+
+    for (; i+16 <= n; i += 16) {
+        const __m128i * p = reinterpret_cast<const __m128i *>(src+i);
+        __m128i a = _mm_loadu_si128(p), b = _mm_loadu_si128(p+1), c = _mm_loadu_si128(p+2), d = _mm_loadu_si128(p+3);
+        __m128i any = _mm_and_si128(_mm_or_si128(_mm_or_si128(a, b), _mm_or_si128(c, d)), high);
+        if (0xffff != _mm_movemask_epi8(_mm_cmpeq_epi32(any, zero))) { break; }
+        __m128i v = _mm_packus_epi16(_mm_packs_epi32(a, b), _mm_packs_epi32(c, d));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(dst+i), v);
+    }
+
+    return i;
+}
+
+std::size_t ascii_run_sse2(const char * src, std::size_t n) {
+    const __m128i lf = _mm_set1_epi8('\n'), cr = _mm_set1_epi8('\r');
+    std::size_t i = 0;
+
+    for (; i+16 <= n; i += 16) {
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src+i));
+        unsigned m = _mm_movemask_epi8(_mm_or_si128(v, _mm_or_si128(_mm_cmpeq_epi8(v, lf), _mm_cmpeq_epi8(v, cr))));
+        if (0 != m) { return i+ctz(m); }
+    }
+
+    return i+ascii_run_scalar(src+i, n-i);
+}
+
+std::size_t find_newline_sse2(const char32_t * src, std::size_t n) {
+    const __m128i lf = _mm_set1_epi32(0x000a), cr = _mm_set1_epi32(0x000d), ls = _mm_set1_epi32(0x2028), ps = _mm_set1_epi32(0x2029);
+    std::size_t i = 0;
+
+    for (; i+4 <= n; i += 4) {
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src+i));
+        __m128i eq = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi32(v, lf), _mm_cmpeq_epi32(v, cr)), _mm_or_si128(_mm_cmpeq_epi32(v, ls), _mm_cmpeq_epi32(v, ps)));
+        unsigned m = _mm_movemask_epi8(eq);
+        if (0 != m) { return i+ctz(m)/4; }
+    }
+
+    return i+find_newline_scalar(src+i, n-i);
+}
+
+#define TAU_AVX2 __attribute__((target("avx2")))
+
+TAU_AVX2
+std::size_t widen_ascii_avx2(const char * src, std::size_t n, char32_t * dst) {
+    std::size_t i = 0;
+
+    for (; i+32 <= n; i += 32) {
+        __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(src+i));
+        if (0 != _mm256_movemask_epi8(v)) { break; }
+        __m128i lo = _mm256_castsi256_si128(v), hi = _mm256_extracti128_si256(v, 1);
+        __m256i * d = reinterpret_cast<__m256i *>(dst+i);
+        _mm256_storeu_si256(d, _mm256_cvtepu8_epi32(lo));
+        _mm256_storeu_si256(d+1, _mm256_cvtepu8_epi32(_mm_srli_si128(lo, 8)));
+        _mm256_storeu_si256(d+2, _mm256_cvtepu8_epi32(hi));
+        _mm256_storeu_si256(d+3, _mm256_cvtepu8_epi32(_mm_srli_si128(hi, 8)));
+    }
+
+    return i+widen_ascii_sse2(src+i, n-i, dst+i);
+}
+
+TAU_AVX2
+std::size_t widen_utf16_avx2(const char * src, std::size_t n, bool be, char32_t * dst) {
+    const __m256i mask = _mm256_set1_epi16(short(0xf800)), sur = _mm256_set1_epi16(short(0xd800));
+    std::size_t i = 0;
+
+    for (; i+16 <= n; i += 16) {
+        __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(src+i+i));
+        if (be) { v = _mm256_or_si256(_mm256_slli_epi16(v, 8), _mm256_srli_epi16(v, 8)); }
+        if (0 != _mm256_movemask_epi8(_mm256_cmpeq_epi16(_mm256_and_si256(v, mask), sur))) { break; }
+        __m256i * d = reinterpret_cast<__m256i *>(dst+i);
+        _mm256_storeu_si256(d, _mm256_cvtepu16_epi32(_mm256_castsi256_si128(v)));
+        _mm256_storeu_si256(d+1, _mm256_cvtepu16_epi32(_mm256_extracti128_si256(v, 1)));
+    }
+
+    return i+widen_utf16_sse2(src+i+i, n-i, be, dst+i);
+}
+
+TAU_AVX2
+std::size_t ascii_run_avx2(const char * src, std::size_t n) {
+    const __m256i lf = _mm256_set1_epi8('\n'), cr = _mm256_set1_epi8('\r');
+    std::size_t i = 0;
+
+    for (; i+32 <= n; i += 32) {
+        __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(src+i));
+        unsigned m = _mm256_movemask_epi8(_mm256_or_si256(v, _mm256_or_si256(_mm256_cmpeq_epi8(v, lf), _mm256_cmpeq_epi8(v, cr))));
+        if (0 != m) { return i+ctz(m); }
+    }
+
+    return i+ascii_run_sse2(src+i, n-i);
+}
+
+TAU_AVX2
+std::size_t find_newline_avx2(const char32_t * src, std::size_t n) {
+    const __m256i lf = _mm256_set1_epi32(0x000a), cr = _mm256_set1_epi32(0x000d), ls = _mm256_set1_epi32(0x2028), ps = _mm256_set1_epi32(0x2029);
+    std::size_t i = 0;
+
+    for (; i+8 <= n; i += 8) {
+        __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(src+i));
+        __m256i eq = _mm256_or_si256(_mm256_or_si256(_mm256_cmpeq_epi32(v, lf), _mm256_cmpeq_epi32(v, cr)), _mm256_or_si256(_mm256_cmpeq_epi32(v, ls), _mm256_cmpeq_epi32(v, ps)));
+        unsigned m = _mm256_movemask_epi8(eq);
+        if (0 != m) { return i+ctz(m)/4; }
+    }
+
+    return i+find_newline_sse2(src+i, n-i);
+}
+
+bool has_avx2() {
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx2");
+}
+
+const bool avx2_ = has_avx2();
+
+inline std::size_t widen_ascii(const char * src, std::size_t n, char32_t * dst) {
+    std::size_t i = avx2_ ? widen_ascii_avx2(src, n, dst) : widen_ascii_sse2(src, n, dst);
+    return i+widen_ascii_scalar(src+i, n-i, dst+i);
+}
+
+inline std::size_t widen_utf16(const char * src, std::size_t n, bool be, char32_t * dst) {
+    std::size_t i = avx2_ ? widen_utf16_avx2(src, n, be, dst) : widen_utf16_sse2(src, n, be, dst);
+    return i+widen_utf16_scalar(src+i+i, n-i, be, dst+i);
+}
+
+inline std::size_t widen_utf32(const char * src, std::size_t n, bool be, char32_t * dst) {
+    std::size_t i = widen_utf32_sse2(src, n, be, dst);
+    return i+widen_utf32_scalar(src+4*i, n-i, be, dst+i);
+}
+
+inline std::size_t narrow_ascii(const char32_t * src, std::size_t n, char * dst) {
+    std::size_t i = narrow_ascii_sse2(src, n, dst);
+    return i+narrow_ascii_scalar(src+i, n-i, dst+i);
+}
+
+inline std::size_t ascii_run_any(const char * src, std::size_t n) {
+    return avx2_ ? ascii_run_avx2(src, n) : ascii_run_sse2(src, n);
+}
+
+inline std::size_t find_newline_any(const char32_t * src, std::size_t n) {
+    return avx2_ ? find_newline_avx2(src, n) : find_newline_sse2(src, n);
+}
+
+#else // TAU_UTF_X86
+
+inline std::size_t widen_ascii(const char * src, std::size_t n, char32_t * dst) {
+    return widen_ascii_scalar(src, n, dst);
+}
+
+inline std::size_t widen_utf16(const char * src, std::size_t n, bool be, char32_t * dst) {
+    return widen_utf16_scalar(src, n, be, dst);
+}
+
+inline std::size_t widen_utf32(const char * src, std::size_t n, bool be, char32_t * dst) {
+    return widen_utf32_scalar(src, n, be, dst);
+}
+
+inline std::size_t narrow_ascii(const char32_t * src, std::size_t n, char * dst) {
+    return narrow_ascii_scalar(src, n, dst);
+}
+
+inline std::size_t ascii_run_any(const char * src, std::size_t n) {
+    return ascii_run_scalar(src, n);
+}
+
+inline std::size_t find_newline_any(const char32_t * src, std::size_t n) {
+    return find_newline_scalar(src, n);
+}
+
+#endif // TAU_UTF_X86
+
+} // anonymous namespace
+
+namespace tau {
+
+std::size_t utf8_decode(const char * src, std::size_t n, char32_t * dst, std::size_t & nchars) {
+    const char * p = src, * end = src+n;
+    char32_t * d = dst;
+
+    while (p < end) {
+        std::size_t k = widen_ascii(p, end-p, d);
+        p += k, d += k;
+
+        // Multibyte sequences are decoded one by one, until the next block boundary.
+        for (std::size_t i = 0; i < 16 && p < end; ++i) {
+            std::size_t len = utf8_char(p, end, *d);
+            if (0 == len) { nchars = d-dst; return p-src; }
+            p += len, ++d;
+        }
+    }
+
+    nchars = d-dst;
+    return p-src;
+}
+
+std::size_t utf16_decode(const char * src, std::size_t n, bool be, char32_t * dst, std::size_t & nchars) {
+    std::size_t i = 0, nunits = n/2;
+    char32_t * d = dst;
+
+    while (i < nunits) {
+        std::size_t k = widen_utf16(src+i+i, nunits-i, be, d);
+        i += k, d += k;
+
+        for (std::size_t j = 0; j < 8 && i < nunits; ++j) {
+            char16_t u = utf16_unit(src+i+i, be);
+
+            if (0xd800 != (0xf800 & u)) {
+                *d++ = u, ++i;
+            }
+
+            else {
+                if (u >= 0xdc00 || i+1 >= nunits) { nchars = d-dst; return i+i; }
+                char16_t u2 = utf16_unit(src+i+i+2, be);
+                if (0xdc00 != (0xfc00 & u2)) { nchars = d-dst; return i+i; }
+                *d++ = tau::char32_from_surrogate(u, u2), i += 2;
+            }
+        }
+    }
+
+    nchars = d-dst;
+    return i+i;
+}
+
+std::size_t utf32_decode(const char * src, std::size_t n, bool be, char32_t * dst, std::size_t & nchars) {
+    nchars = widen_utf32(src, n/4, be, dst);
+    return 4*nchars;
+}
+
+void utf8_encode(const char32_t * src, std::size_t n, std::string & dst) {
+    char buffer[32];
+    dst.reserve(dst.size()+n);
+
+    for (std::size_t i = 0; i < n; ) {
+        std::size_t k = narrow_ascii(src+i, std::min(n-i, sizeof buffer), buffer);
+
+        if (0 != k) {
+            dst.append(buffer, k);
+            i += k;
+        }
+
+        else {
+            std::size_t len = tau::char32_to_utf8(src[i++], buffer, 8);
+            dst.append(buffer, len);
+        }
+    }
+}
+
+std::size_t ascii_run(const char * src, std::size_t n) {
+    return ascii_run_any(src, n);
+}
+
+std::size_t find_newline(const char32_t * src, std::size_t n) {
+    return find_newline_any(src, n);
+}
+
+} // namespace tau
+
+//END
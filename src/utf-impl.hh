@@ -0,0 +1,87 @@
+// ----------------------------------------------------------------------------
+// Copyright © 2014-2023 Konstantin Shmelkov <mrcashe@gmail.com>.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+// PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+// OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+// WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+// OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+// EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+// ----------------------------------------------------------------------------
+
+#ifndef TAU_UTF_IMPL_HH
+#define TAU_UTF_IMPL_HH
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace tau {
+
+// Bulk Unicode transformations used by Buffer and ustring.
+// On x86 the SSE2 or AVX2 code path is chosen at run time, scalar code used elsewhere.
+// Decoders stop before invalid or incomplete input, returning count of consumed bytes,
+// count of produced characters returned within nchars.
+
+// Decodes single UTF-8 character, returns its length in bytes or 0 if sequence is
+// invalid or incomplete. Overlong sequences, surrogates and values above U+10FFFF are invalid.
+inline std::size_t utf8_char(const char * p, const char * end, char32_t & wc) {
+    uint8_t c = *p;
+    std::size_t len;
+    char32_t min;
+
+    if (c < 0x80) { wc = c; return 1; }
+    else if (0xc0 == (0xe0 & c)) { wc = 0x1f & c; len = 2; min = 0x80; }
+    else if (0xe0 == (0xf0 & c)) { wc = 0x0f & c; len = 3; min = 0x800; }
+    else if (0xf0 == (0xf8 & c)) { wc = 0x07 & c; len = 4; min = 0x10000; }
+    else { return 0; }
+
+    if (std::size_t(end-p) < len) { return 0; }
+
+    for (std::size_t i = 1; i < len; ++i) {
+        c = p[i];
+        if (0x80 != (0xc0 & c)) { return 0; }
+        wc = (wc << 6) | (0x3f & c);
+    }
+
+    if (wc < min || wc > 0x10ffff || (wc >= 0xd800 && wc < 0xe000)) { return 0; }
+    return len;
+}
+
+// Decodes UTF-8, dst must have room for n characters.
+std::size_t utf8_decode(const char * src, std::size_t n, char32_t * dst, std::size_t & nchars);
+
+// Decodes UTF-16, dst must have room for n/2 characters.
+// Stops before unpaired surrogate.
+std::size_t utf16_decode(const char * src, std::size_t n, bool be, char32_t * dst, std::size_t & nchars);
+
+// Decodes UTF-32, dst must have room for n/4 characters.
+std::size_t utf32_decode(const char * src, std::size_t n, bool be, char32_t * dst, std::size_t & nchars);
+
+// Encodes n characters into UTF-8 and appends result to dst.
+void utf8_encode(const char32_t * src, std::size_t n, std::string & dst);
+
+// Returns length of leading run of 7-bit bytes other than CR and LF.
+std::size_t ascii_run(const char * src, std::size_t n);
+
+// Finds first of U+000A, U+000D, U+2028 or U+2029, returns n if not found.
+std::size_t find_newline(const char32_t * src, std::size_t n);
+
+} // namespace tau
+
+#endif // TAU_UTF_IMPL_HH
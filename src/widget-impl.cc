@@ -223,14 +223,30 @@ bool Widget_impl::hidden() const {
 
 // Overriden by Window_impl.
 void Widget_impl::invalidate(const Rect & r) {
+    drop_display_lists();
+    invalidate_parent(r ? r : visible_area());
+}
+
+// protected
+void Widget_impl::invalidate_parent(const Rect & r) {
     if (!shut_ && parent_) {
-        Rect inval(r ? r : visible_area());
-        inval.intersect(visible_area());
+        Rect inval(r & visible_area());
         inval.translate(origin_-scroll_position());
-        if (inval) { parent_->invalidate(inval); }
+        if (inval) { parent_->invalidate_up(inval); }
     }
 }
 
+// protected
+void Widget_impl::drop_display_lists() {
+    paint_list_.reset();
+    backpaint_list_.reset();
+}
+
+void Widget_impl::disable_retained_paint() {
+    retained_ = false;
+    drop_display_lists();
+}
+
 // Overriden by Container_impl.
 bool Widget_impl::hover() const {
     return !shut_ && parent_ && (this == parent_->mouse_grabber() || this == parent_->mouse_owner());
@@ -701,9 +717,9 @@ signal<void()> & Widget_impl::signal_scroll_changed() {
     return *signal_scroll_changed_;
 }
 
+// Invalidation done by Scroller_impl, see Scroller_impl::scroll_pixels().
 void Widget_impl::on_pan_changed() {
     update_pdata();
-    invalidate();
 }
 
 // Overriden by Container_impl.
@@ -1096,12 +1112,37 @@ signal<bool(int, int, Point)> & Widget_impl::signal_mouse_wheel() {
 
 // Overriden by Container_impl.
 void Widget_impl::handle_paint(Painter pr, const Rect & inval) {
-    signal_paint_(pr, inval.translated(scroll_position()));
+    if (retained_) { paint_retained(pr, inval, false); }
+    else { signal_paint_(pr, inval.translated(scroll_position())); }
 }
 
 // Overriden by Container_impl.
 void Widget_impl::handle_backpaint(Painter pr, const Rect & inval) {
-    signal_backpaint_(pr, inval.translated(scroll_position()));
+    if (retained_) { paint_retained(pr, inval, true); }
+    else { signal_backpaint_(pr, inval.translated(scroll_position())); }
+}
+
+// private
+// Display list recorded only when whole visible area painted, it is kept
+// until invalidate() called or size or scroll position changed.
+void Widget_impl::paint_retained(Painter pr, const Rect & inval, bool backpaint) {
+    Display_list_ptr & dl = backpaint ? backpaint_list_ : paint_list_;
+    Painter_ptr pp = pr.impl;
+    Point sc = scroll_position();
+    Rect r = inval.translated(sc);
+
+    if (dl && (dl->size != size_ || dl->scroll != sc)) { dl.reset(); }
+    if (dl) { pp->replay(*dl); return; }
+    bool whole = r.contains(visible_area());
+    if (whole) { pp->begin_record(); }
+    if (backpaint) { signal_backpaint_(pr, r); }
+    else { signal_paint_(pr, r); }
+
+    if (whole) {
+        dl = pp->end_record();
+        dl->size = size_;
+        dl->scroll = sc;
+    }
 }
 
 // Overriden by Container_impl.
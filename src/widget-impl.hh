@@ -332,6 +332,11 @@ public:
     void handle_visible(bool show);
     void handle_enable(bool yes);
 
+    // Retained painting, see Widget::enable_retained_paint().
+    void   enable_retained_paint() { retained_ = true; }
+    void   disable_retained_paint();
+    bool   retained_paint_enabled() const { return retained_; }
+
     void   scroll_to(const Point & pt);
     void   scroll_to(int x, int y);
     void   scroll_to_x(int x);
@@ -448,6 +453,8 @@ protected:
     void thaw();
     void disappear();
     void appear();
+    void invalidate_parent(const Rect & r);
+    void drop_display_lists();
 
 private:
 
@@ -490,6 +497,10 @@ private:
     signal<void()> * signal_scroll_changed_ = nullptr;
     signal<Action_base *(char32_t, int)> * signal_lookup_action_ = nullptr;
 
+    bool        retained_ = false;
+    Display_list_ptr paint_list_;       // Retained signal_paint_ output.
+    Display_list_ptr backpaint_list_;   // Retained signal_backpaint_ output.
+
 private:
 
     void update_cursor();
@@ -497,6 +508,7 @@ private:
     void leave_cursor();
 
     bool on_backpaint(Painter pr, const Rect & inval);
+    void paint_retained(Painter pr, const Rect & inval, bool backpaint);
     void on_tooltip_timer();
     void on_enable();
     void on_disable();
@@ -334,6 +334,18 @@ void Widget::invalidate(const Rect & r) {
     impl->invalidate(r);
 }
 
+void Widget::enable_retained_paint() {
+    impl->enable_retained_paint();
+}
+
+void Widget::disable_retained_paint() {
+    impl->disable_retained_paint();
+}
+
+bool Widget::retained_paint_enabled() const {
+    return impl->retained_paint_enabled();
+}
+
 Painter Widget::painter() {
     return impl->painter();
 }
@@ -40,6 +40,16 @@ Window_impl::Window_impl():
 {
     signal_focus_in_.connect(fun(this, &Widget_impl::resume_focus));
     signal_focus_out_.connect(fun(this, &Widget_impl::suspend_focus));
+    if (Paint_profiler::env_enabled()) { enable_paint_profile(); }
+}
+
+void Window_impl::enable_paint_profile() {
+    if (!profiler_) { profiler_ = new Paint_profiler; }
+    profile_ = true;
+}
+
+std::vector<Paint_profile> Window_impl::paint_profile() const {
+    return profile_ ? profiler_->records() : std::vector<Paint_profile>();
 }
 
 void Window_impl::close() {
@@ -382,6 +392,12 @@ void Window_impl::close_tooltip(Widget_impl * caller) {
 
 // Overrides Widget_impl.
 void Window_impl::invalidate(const Rect & inval) {
+    drop_display_lists();
+    winface_->invalidate(inval);
+}
+
+// Overrides Container_impl.
+void Window_impl::invalidate_up(const Rect & inval) {
     winface_->invalidate(inval);
 }
 
@@ -29,6 +29,7 @@
 
 #include <tau/enums.hh>
 #include <bin-impl.hh>
+#include <profiler-impl.hh>
 
 namespace tau {
 
@@ -42,6 +43,10 @@ public:
 
     virtual void update() = 0;
     virtual void invalidate(const Rect & inval) = 0;
+
+    // Moves pixels within area by delta and invalidates uncovered part of the area.
+    // Returns false if pixels can not be moved, the caller must invalidate whole area then.
+    virtual bool scroll(const Rect & area, const Point & delta) = 0;
     virtual Painter_ptr painter() = 0;
 
     virtual void move(const Point & pt) = 0;
@@ -160,6 +165,9 @@ public:
     // Overrides Widget_impl.
     void invalidate(const Rect & inval=Rect()) override;
 
+    // Overrides Container_impl.
+    void invalidate_up(const Rect & inval) override;
+
     // Overrides Widget_impl.
     Painter painter() override;
 
@@ -180,6 +188,18 @@ public:
     void resize(unsigned width, unsigned height);
     void update();
 
+    void enable_double_buffer() { double_buffer_ = true; }
+    void disable_double_buffer() { double_buffer_ = false; }
+    bool double_buffer_enabled() const { return double_buffer_; }
+
+    void enable_paint_profile();
+    void disable_paint_profile() { profile_ = false; }
+    bool paint_profile_enabled() const { return profile_; }
+    std::vector<Paint_profile> paint_profile() const;
+
+    // Returns nullptr when paint profiling disabled.
+    Paint_profiler * paint_profiler() { return profile_ ? profiler_ : nullptr; }
+
     /// @return Pointer to the created tooltip window.
     Window_ptr open_tooltip(Widget_impl * caller, Widget_ptr tooltip);
     Window_ptr open_tooltip(Widget_impl * caller, Widget_ptr tooltip, const Point & pt, Gravity gravity, unsigned time_ms);
@@ -203,6 +223,9 @@ protected:
     Point               position_;              // Position within the screen.
     Rect                client_area_;
     Window_ptr          wpp_;                   // An optional parent window.
+    bool                double_buffer_ = false; // Paint through off-screen buffer.
+    bool                profile_ = false;       // Paint profiling enabled.
+    Paint_profiler *    profiler_ = nullptr;    // Kept until destruction, painter may still refer it.
 
     signal<void()>      signal_close_;
     signal<void()>      signal_position_changed_;
@@ -210,7 +233,7 @@ protected:
 protected:
 
     Window_impl();
-   ~Window_impl() { signal_destroy_(); }
+   ~Window_impl() { signal_destroy_(); delete profiler_; }
 
     // Overrides Container_impl.
     void queue_arrange_up() override;
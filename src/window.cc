@@ -74,6 +74,34 @@ void Window::update() {
     WINDOW_IMPL->update();
 }
 
+void Window::enable_double_buffer() {
+    WINDOW_IMPL->enable_double_buffer();
+}
+
+void Window::disable_double_buffer() {
+    WINDOW_IMPL->disable_double_buffer();
+}
+
+bool Window::double_buffer_enabled() const {
+    return WINDOW_IMPL->double_buffer_enabled();
+}
+
+void Window::enable_paint_profile() {
+    WINDOW_IMPL->enable_paint_profile();
+}
+
+void Window::disable_paint_profile() {
+    WINDOW_IMPL->disable_paint_profile();
+}
+
+bool Window::paint_profile_enabled() const {
+    return WINDOW_IMPL->paint_profile_enabled();
+}
+
+std::vector<Paint_profile> Window::paint_profile() const {
+    return WINDOW_IMPL->paint_profile();
+}
+
 signal<void()> & Window::signal_position_changed() {
     return WINDOW_IMPL->signal_position_changed();
 }
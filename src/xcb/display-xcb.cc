@@ -40,6 +40,8 @@
 #include <xcb/xfixes.h>
 #include <unistd.h>
 #include <fcntl.h>
+#include <sys/ipc.h>
+#include <sys/shm.h>
 #include <sys/socket.h>
 #include <climits>
 #include <cstring>
@@ -621,6 +623,7 @@ void Display_xcb::open(const ustring & args) {
     init_xkb();
     init_xsync();
     init_xfixes();
+    init_xshm(args);
 
     whidden_ = xcb_generate_id(cx_);
     uint32_t vals[1] = { 0 };
@@ -668,6 +671,8 @@ Display_xcb::~Display_xcb() {
             xcb_render_free_picture(cx_, p.second);
         }
 
+        shm_detach();
+
         xcb_disconnect(cx_);
         cx_ = nullptr;
     }
@@ -704,6 +709,99 @@ void Display_xcb::init_xsync() {
     if (e) { std::free(e); }
 }
 
+// MIT-SHM can be disabled by "noshm" word within Display::open() arguments
+// or by setting TAU_XCB_SHM environment variable to "0".
+void Display_xcb::init_xshm(const ustring & args) {
+    for (const ustring & arg: str_explode(args)) {
+        if ("noshm" == arg) { return; }
+    }
+
+    if ("0" == str_env("TAU_XCB_SHM")) { return; }
+    xcb_shm_query_version_cookie_t ck = xcb_shm_query_version(cx_);
+    xcb_generic_error_t * e = nullptr;
+
+    if (xcb_shm_query_version_reply_t * reply = xcb_shm_query_version_reply(cx_, ck, &e)) {
+        xshm_version_ = reply->major_version;
+        xshm_version_ <<= 8;
+        xshm_version_ += reply->minor_version;
+        std::free(reply);
+    }
+
+    if (e) { std::free(e); }
+}
+
+uint8_t * Display_xcb::shm_map(std::size_t nbytes) {
+    if (0 == xshm_version_) { return nullptr; }
+
+    if (shm_.busy) {
+        if (auto reply = xcb_get_input_focus_reply(cx_, shm_.fence, nullptr)) { std::free(reply); }
+        shm_.busy = false;
+    }
+
+    if (shm_.size < nbytes) {
+        shm_detach();
+        std::size_t size = std::max(nbytes, std::size_t(1) << 20);
+        int shmid = shmget(IPC_PRIVATE, size, IPC_CREAT|0600);
+
+        if (-1 != shmid) {
+            void * addr = shmat(shmid, nullptr, 0);
+
+            if (reinterpret_cast<void *>(-1) != addr) {
+                shm_.seg = xcb_generate_id(cx_);
+
+                // The server can not attach segment when connected remotely.
+                if (0 == request_check(xcb_shm_attach_checked(cx_, shm_.seg, shmid, 1))) {
+                    shm_.addr = static_cast<uint8_t *>(addr);
+                    shm_.size = size;
+                }
+
+                else {
+                    shmdt(addr);
+                    shm_.seg = XCB_NONE;
+                }
+            }
+
+            // Segment will be destroyed after both sides detach.
+            shmctl(shmid, IPC_RMID, nullptr);
+        }
+
+        if (!shm_.addr) {
+            std::cerr << "** Display_xcb: MIT-SHM unavailable, falling back to xcb_put_image()" << std::endl;
+            xshm_version_ = 0;
+        }
+    }
+
+    return shm_.addr;
+}
+
+void Display_xcb::shm_fence() {
+    if (shm_.busy) {
+        xcb_discard_reply(cx_, shm_.fence.sequence);
+    }
+
+    shm_.fence = xcb_get_input_focus(cx_);
+    shm_.busy = true;
+}
+
+void Display_xcb::shm_detach() {
+    if (shm_.busy) {
+        if (auto reply = xcb_get_input_focus_reply(cx_, shm_.fence, nullptr)) { std::free(reply); }
+        shm_.busy = false;
+    }
+
+    if (XCB_NONE != shm_.seg) {
+        xcb_shm_detach(cx_, shm_.seg);
+        shm_.seg = XCB_NONE;
+    }
+
+    if (shm_.addr) {
+        shmdt(shm_.addr);
+        shm_.addr = nullptr;
+    }
+
+    shm_.size = 0;
+}
+
 void Display_xcb::init_xkb() {
     int result = xkb_x11_setup_xkb_extension(cx_,
                                              XKB_X11_MIN_MAJOR_XKB_VERSION, XKB_X11_MIN_MINOR_XKB_VERSION,
@@ -1103,6 +1201,16 @@ void Display_xcb::handle_xcb_event(xcb_generic_event_t * event) {
         }
             break;
 
+        case XCB_GRAPHICS_EXPOSURE:
+        {
+            auto gexpose = reinterpret_cast<xcb_graphics_exposure_event_t *>(event);
+            if (auto wf = find(gexpose->drawable)) { wf->handle_graphics_expose(gexpose); }
+        }
+            break;
+
+        case XCB_NO_EXPOSURE:
+            break;
+
         case XCB_CONFIGURE_NOTIFY:
         {
             auto configure = reinterpret_cast<xcb_configure_notify_event_t *>(event);
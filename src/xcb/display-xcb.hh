@@ -33,6 +33,7 @@
 #include <display-impl.hh>
 #include <xkbcommon/xkbcommon-x11.h>
 #include <xcb/xcb_cursor.h>
+#include <xcb/shm.h>
 #include <atomic>
 #include <map>
 #include <mutex>
@@ -117,6 +118,17 @@ public:
     xcb_connection_t * conn() { return cx_; }
     uint16_t xsync_version() const { return xsync_version_; }
     uint16_t xfixes_version() const { return xfixes_version_; }
+    uint16_t xshm_version() const { return xshm_version_; }
+
+    // Returns mapped MIT-SHM segment of at least nbytes size or nullptr if MIT-SHM unavailable.
+    // Waits until the server done with previous upload, so returned memory can be written.
+    uint8_t * shm_map(std::size_t nbytes);
+
+    // Segment returned by last shm_map() call.
+    xcb_shm_seg_t shm_seg() const { return shm_.seg; }
+
+    // Marks segment busy until the server processes requests issued so far.
+    void shm_fence();
 
 protected:
 
@@ -135,6 +147,15 @@ protected:
 
 private:
 
+    // MIT-SHM segment, shared by all uploads and grown on demand.
+    struct Shm_segment {
+        xcb_shm_seg_t   seg = XCB_NONE;
+        uint8_t *       addr = nullptr;
+        std::size_t     size = 0;
+        bool            busy = false;
+        xcb_get_input_focus_cookie_t fence;
+    };
+
     struct Pict_format {
         uint16_t depth;
         uint16_t red_shift;
@@ -177,6 +198,8 @@ private:
     Timeval             idle_ts_;
     uint16_t            xsync_version_ = 0;
     uint16_t            xfixes_version_ = 0;
+    uint16_t            xshm_version_ = 0;
+    Shm_segment         shm_;
     Atoms               atoms_;
     RAtoms              ratoms_;
     xcb_visualid_t      visualid_ = XCB_NONE;
@@ -198,6 +221,8 @@ private:
     void init_xrender();
     void init_xfixes();
     void init_xsync();
+    void init_xshm(const ustring & args);
+    void shm_detach();
 
     Winface_xcb_ptr find(xcb_window_t xid);
     bool query_pointer(xcb_window_t wid, Point & pt) const;
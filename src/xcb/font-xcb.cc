@@ -24,12 +24,14 @@
 // EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 // ----------------------------------------------------------------------------
 
-#include <tau/brush.hh>
-#include <tau/painter.hh>
+#include <tau/locale.hh>
 #include <tau/string.hh>
-#include <pixmap-impl.hh>
+#include <painter-impl.hh>
+#include <posix/font-face-posix.hh>
+#include <posix/font-file-posix.hh>
 #include "font-xcb.hh"
 #include <cstring>
+#include <sys/stat.h>
 
 namespace tau {
 
@@ -40,13 +42,58 @@ Font_xcb::Font_xcb(Font_face_ptr fface, const ustring & spec, double size_pt, Di
 {
     east_ = xcb_generate_id(cx_);
     xcb_render_create_glyph_set(cx_, east_, dp_->pictformat(format_));
+
+    if (Glyph_cache_xcb::enabled()) {
+        ustring path = fface->font_file()->file_path();
+        auto & io = Locale().iocharset();
+        struct stat st;
+
+        if (0 == stat((io.is_utf8() ? std::string(path) : io.encode(path)).c_str(), &st)) {
+            gcache_ = std::make_unique<Glyph_cache_xcb>(str_format(path, '\t', fface->family(), '\t', fface->facename(), '\t',
+                st.st_mtime, '\t', st.st_size, '\t', size_pt, '\t', dpi()));
+        }
+    }
 }
 
 Font_xcb::~Font_xcb() {
     xcb_render_free_glyph_set(cx_, east_);
 }
 
-void Font_xcb::render_glyphs(const std::u32string & str, Point pt, uint8_t op, xcb_render_picture_t src, xcb_render_picture_t dst) {
+// protected
+// Overrides Font_impl.
+int Font_xcb::measure(char32_t wc) {
+    if (gcache_ && !char32_is_zerowidth(wc)) {
+        if (auto ce = gcache_->find(wc)) {
+            return ce->info.x_off;
+        }
+    }
+
+    return Font_posix::measure(wc);
+}
+
+// private
+unsigned Font_xcb::add_glyphs() {
+    if (ginfos_.empty()) { return 0; }
+    xcb_render_add_glyphs(cx_, east_, ginfos_.size(), new_chars_.data(), ginfos_.data(), bits_.size(), bits_.data());
+    ginfos_.clear();
+    new_chars_.clear();
+    bits_.clear();
+    return 1;
+}
+
+// New glyphs rasterized straight into A8 glyph images and uploaded
+// in batches, rows are padded to 4 bytes as XRender requires.
+unsigned Font_xcb::render_glyphs(Painter_impl & pr, const std::u32string & str, Point pt, uint8_t op, xcb_render_picture_t src, xcb_render_picture_t dst) {
+    unsigned nreq = 0;
+
+    // RenderAddGlyphs request: 12 byte header, glyph id and glyph info per glyph, then bits.
+    // Pending glyphs are uploaded before the new one would exceed maximal request length.
+    const std::size_t max_bytes = 4*std::size_t(xcb_get_maximum_request_length(cx_));
+    auto reserve = [this, max_bytes, &nreq](std::size_t nbits) {
+        std::size_t len = 12+(ginfos_.size()+1)*(sizeof(uint32_t)+sizeof(xcb_render_glyphinfo_t))+bits_.size()+nbits;
+        if (len > max_bytes) { nreq += add_glyphs(); }
+    };
+
     xcb_render_glyphset_t gs = east_;
 
     std::size_t n = 254*4;
@@ -55,14 +102,32 @@ void Font_xcb::render_glyphs(const std::u32string & str, Point pt, uint8_t op, x
     const char32_t * cstr = str.c_str();
     const char32_t * s = cstr;
 
-    uint32_t new_chars[n];
-    uint32_t * nnc = new_chars;
-
     Point pts[n];
     Point * ppts = pts;
 
     for (; ns; --ns, ++s) {
         *ppts++ = pt;
+
+        // Glyphs found in the glyph cache need no outlines at all.
+        if (const Glyph_cache_xcb::Entry * ce = gcache_ ? gcache_->find(*s) : nullptr) {
+            pt.translate(ce->info.x_off, ce->info.y_off);
+
+            if (0 == chars_.count(*s)) {
+                chars_.insert(*s);
+
+                if (0 != ce->info.width && 0 != ce->info.height) {
+                    std::size_t nbits = Glyph_cache_xcb::bytes(ce->info);
+                    reserve(nbits);
+                    ginfos_.push_back(ce->info);
+                    new_chars_.push_back(*s);
+                    const uint8_t * bits = gcache_->bits(*ce);
+                    bits_.insert(bits_.end(), bits, bits+nbits);
+                }
+            }
+
+            continue;
+        }
+
         auto g = glyph(*s);
 
         if (g) {
@@ -73,40 +138,41 @@ void Font_xcb::render_glyphs(const std::u32string & str, Point pt, uint8_t op, x
                 chars_.insert(*s);
 
                 if (Rect r = g->bounds()) {
-                    Pixmap_ptr pix = Pixmap_impl::create(format_, r.size());
+                    std::size_t stride = (r.width()+3) & ~std::size_t(3);
+                    reserve(stride*r.height());
+                    ginfos_.emplace_back();
+                    xcb_render_glyphinfo_t & ginfo = ginfos_.back();
 
-                    if (auto pr = pix->painter()) {
-                        pr.move_to(-r.left(), std::ceil(g->max().y()));
-                        pr.glyph(Glyph_impl::wrap(g));
-                        pr.set_brush(Color(COLOR_WHITE));
-                        pr.fill();
+                    ginfo.width = r.width();
+                    ginfo.height = r.height();
 
-                        ginfos_.emplace_back();
-                        xcb_render_glyphinfo_t & ginfo = ginfos_.back();
+                    ginfo.x = -std::floor(g->bearing().x());
+                    ginfo.y = std::floor(g->max().y());
 
-                        ginfo.width = pix->size().width();
-                        ginfo.height = pix->size().height();
+                    ginfo.x_off = std::ceil(adv.x());
+                    ginfo.y_off = std::ceil(adv.y());
 
-                        ginfo.x = -std::floor(g->bearing().x());
-                        ginfo.y = std::floor(g->max().y());
+                    new_chars_.push_back(*s);
+                    std::size_t nbits = bits_.size();
+                    bits_.resize(nbits+stride*r.height(), 0);
 
-                        ginfo.x_off = std::ceil(adv.x());
-                        ginfo.y_off = std::ceil(adv.y());
+                    auto ctrs = g->contours();
+                    Vector org(-r.left(), std::ceil(g->max().y()));
+                    for (Contour & ctr: ctrs) { ctr.scale(Vector(1.0, -1.0, 1.0)); ctr.translate(org); }
+                    pr.raster_coverage(ctrs.data(), ctrs.size(), bits_.data()+nbits, r.size(), stride);
+                    if (gcache_) { gcache_->add(*s, ginfo, bits_.data()+nbits); }
+                }
 
-                        *nnc++ = *s;
-                        std::size_t nbits = bits_.size(), nbytes = pix->bytes();
-                        bits_.resize(nbits+nbytes);
-                        uint8_t * pbits = bits_.data();
-                        if (pbits) { std::memcpy(pbits+nbits, pix->raw(), nbytes); }
-                    }
+                // Glyph without outlines, only metrics are cached.
+                else if (gcache_) {
+                    xcb_render_glyphinfo_t ginfo = { 0, 0, 0, 0, int16_t(std::ceil(adv.x())), int16_t(std::ceil(adv.y())) };
+                    gcache_->add(*s, ginfo, nullptr);
                 }
             }
         }
     }
 
-    xcb_render_add_glyphs(cx_, gs, ginfos_.size(), new_chars, ginfos_.data(), bits_.size(), bits_.data());
-    ginfos_.clear();
-    bits_.clear();
+    nreq += add_glyphs();
 
     // X11 protocol can accept no more than 1Kb of data per call.
     // It gives maximal glyph string length of 254 characters.
@@ -124,12 +190,13 @@ void Font_xcb::render_glyphs(const std::u32string & str, Point pt, uint8_t op, x
         *p = ppts->y();
         std::memcpy(buffer+8, cstr, 4*nchars);
         xcb_render_composite_glyphs_32(cx_, op, src, dst, 0, gs, 0, 0, nb, buffer);
+        ++nreq;
         n -= nchars;
         ppts += nchars;
         cstr += nchars;
     }
 
-    xcb_flush(cx_);
+    return nreq;
 }
 
 } // namespace tau
@@ -31,6 +31,8 @@
 #include <sys-impl.hh>
 #include <posix/font-posix.hh>
 #include "display-xcb.hh"
+#include "glyph-cache-xcb.hh"
+#include <memory>
 #include <set>
 
 namespace tau {
@@ -41,7 +43,18 @@ public:
     Font_xcb(Font_face_ptr fface, const ustring & spec, double size_pt, Display_xcb_ptr dp);
    ~Font_xcb();
 
-    void render_glyphs(const std::u32string & str, Point pt, uint8_t oper, xcb_render_picture_t src, xcb_render_picture_t dst);
+    // Returns number of requests issued, does not flush connection.
+    // New glyphs are rasterized using given painter's rasterizer.
+    unsigned render_glyphs(Painter_impl & pr, const std::u32string & str, Point pt, uint8_t oper, xcb_render_picture_t src, xcb_render_picture_t dst);
+
+protected:
+
+    // Overrides Font_impl.
+    int measure(char32_t wc) override;
+
+private:
+
+    unsigned add_glyphs();
 
 private:
 
@@ -56,8 +69,10 @@ private:
     xcb_render_glyphset_t   east_ = XCB_NONE;
     Chars                   chars_;
     std::vector<uint8_t>    bits_;
+    std::vector<uint32_t>   new_chars_;
     const uint8_t           format_ = 8;
     std::vector<xcb_render_glyphinfo_t> ginfos_;
+    std::unique_ptr<Glyph_cache_xcb> gcache_;
 };
 
 } // namespace tau
@@ -41,19 +41,27 @@ Context_xcb::~Context_xcb() {
     xcb_free_gc(cx_, gc_);
 }
 
+void Context_xcb::change(uint32_t flag, uint32_t & value, uint32_t v) {
+    if ((valid_ & flag) && !(flags_ & flag) && value == v) {
+        if (counters_) { ++counters_->gc_skipped; }
+    }
+
+    else {
+        flags_ |= flag;
+        value = v;
+    }
+}
+
 void Context_xcb::set_func(xcb_gx_t func) {
-    flags_ |= XCB_GC_FUNCTION;
-    func_ = func;
+    change(XCB_GC_FUNCTION, func_, func);
 }
 
 void Context_xcb::set_plane_mask(uint32_t pmask) {
-    flags_ |= XCB_GC_PLANE_MASK;
-    pmask_ = pmask;
+    change(XCB_GC_PLANE_MASK, pmask_, pmask);
 }
 
 void Context_xcb::set_foreground(const Color & color) {
-    flags_ |= XCB_GC_FOREGROUND;
-    fore_ = color.argb32();
+    change(XCB_GC_FOREGROUND, fore_, color.argb32());
 }
 
 Color Context_xcb::foreground() const {
@@ -61,90 +69,96 @@ Color Context_xcb::foreground() const {
 }
 
 void Context_xcb::set_background(const Color & color) {
-    flags_ |= XCB_GC_BACKGROUND;
-    back_ = color.argb32();
+    change(XCB_GC_BACKGROUND, back_, color.argb32());
 }
 
 void Context_xcb::set_line_width(uint32_t width) {
-    flags_ |= XCB_GC_LINE_WIDTH;
-    linewidth_ = width;
+    change(XCB_GC_LINE_WIDTH, linewidth_, width);
 }
 
 void Context_xcb::set_line_style(uint32_t lstyle) {
-    flags_ |= XCB_GC_LINE_STYLE;
-    lstyle_ = lstyle;
+    change(XCB_GC_LINE_STYLE, lstyle_, lstyle);
 }
 
 void Context_xcb::set_cap_style(uint32_t capstyle) {
-    flags_ |= XCB_GC_CAP_STYLE;
-    capstyle_ = capstyle;
+    change(XCB_GC_CAP_STYLE, capstyle_, capstyle);
 }
 
 void Context_xcb::set_join_style(uint32_t jstyle) {
-    flags_ |= XCB_GC_JOIN_STYLE;
-    jstyle_ = jstyle;
+    change(XCB_GC_JOIN_STYLE, jstyle_, jstyle);
 }
 
 void Context_xcb::set_fill_style(uint32_t fstyle) {
-    flags_ |= XCB_GC_FILL_STYLE;
-    fstyle_ = fstyle;
+    change(XCB_GC_FILL_STYLE, fstyle_, fstyle);
 }
 
 void Context_xcb::set_fill_rule(uint32_t frule) {
-    flags_ |= XCB_GC_FILL_RULE;
-    frule_ = frule;
+    change(XCB_GC_FILL_RULE, frule_, frule);
 }
 
 void Context_xcb::set_tile(uint32_t tile) {
-    flags_ |= XCB_GC_TILE;
-    tile_ = tile;
+    change(XCB_GC_TILE, tile_, tile);
 }
 
 void Context_xcb::set_stipple(uint32_t stipple) {
-    flags_ |= XCB_GC_STIPPLE;
-    stipple_ = stipple;
+    change(XCB_GC_STIPPLE, stipple_, stipple);
 }
 
 void Context_xcb::set_tile_stipple_origin(const Point & origin) {
-    xstipple_ = static_cast<uint32_t>(origin.x());
-    ystipple_ = static_cast<uint32_t>(origin.y());
-    flags_ |= (XCB_GC_TILE_STIPPLE_ORIGIN_X|XCB_GC_TILE_STIPPLE_ORIGIN_Y);
+    change(XCB_GC_TILE_STIPPLE_ORIGIN_X, xstipple_, static_cast<uint32_t>(origin.x()));
+    change(XCB_GC_TILE_STIPPLE_ORIGIN_Y, ystipple_, static_cast<uint32_t>(origin.y()));
 }
 
 void Context_xcb::set_subwindow_mode(bool on) {
-    flags_ |= XCB_GC_SUBWINDOW_MODE;
-    subwindow_ = on;
+    change(XCB_GC_SUBWINDOW_MODE, subwindow_, on);
 }
 
 void Context_xcb::set_graphics_exposures(bool on) {
-    flags_ |= XCB_GC_GRAPHICS_EXPOSURES;
-    expose_ = on;
+    change(XCB_GC_GRAPHICS_EXPOSURES, expose_, on);
 }
 
 void Context_xcb::set_clip_mask(uint32_t mask) {
     flags_ |= XCB_GC_CLIP_MASK;
     clip_ = mask;
+    clip_valid_ = false;
 }
 
 void Context_xcb::set_clip_origin(const Point & origin) {
-    flags_ |= (XCB_GC_CLIP_ORIGIN_X|XCB_GC_CLIP_ORIGIN_Y);
-    cx_origin_ = static_cast<uint32_t>(origin.x());
-    cy_origin_ = static_cast<uint32_t>(origin.y());
+    change(XCB_GC_CLIP_ORIGIN_X, cx_origin_, static_cast<uint32_t>(origin.x()));
+    change(XCB_GC_CLIP_ORIGIN_Y, cy_origin_, static_cast<uint32_t>(origin.y()));
 }
 
 void Context_xcb::set_dash_offset(uint32_t ofs) {
-    flags_ |= XCB_GC_DASH_OFFSET;
-    doffset_ = ofs;
+    change(XCB_GC_DASH_OFFSET, doffset_, ofs);
 }
 
 void Context_xcb::set_dash_list(uint32_t list) {
-    flags_ |= XCB_GC_DASH_LIST;
-    dlist_ = list;
+    change(XCB_GC_DASH_LIST, dlist_, list);
 }
 
 void Context_xcb::set_arc_mode(uint32_t mode) {
-    flags_ |= XCB_GC_ARC_MODE;
-    arcmode_ = mode;
+    change(XCB_GC_ARC_MODE, arcmode_, mode);
+}
+
+bool Context_xcb::clip_equals(const xcb_rectangle_t * rs, std::size_t nrs) const {
+    return clip_valid_ && xcb_rectangles_equal(clip_rects_.data(), clip_rects_.size(), rs, nrs);
+}
+
+// Also resets clip origin to (0, 0), so pending clip origin changes are flushed first.
+void Context_xcb::set_clip_rectangles(const xcb_rectangle_t * rs, std::size_t nrs, uint8_t ordering) {
+    if (clip_equals(rs, nrs)) {
+        if (counters_) { ++counters_->gc_skipped; }
+    }
+
+    else {
+        flush();
+        xcb_set_clip_rectangles(cx_, ordering, gc_, 0, 0, nrs, rs);
+        if (counters_) { ++counters_->requests; }
+        clip_rects_.assign(rs, rs+nrs);
+        clip_valid_ = true;
+        cx_origin_ = cy_origin_ = 0;
+        valid_ |= XCB_GC_CLIP_ORIGIN_X|XCB_GC_CLIP_ORIGIN_Y;
+    }
 }
 
 void Context_xcb::flush() const {
@@ -175,6 +189,8 @@ void Context_xcb::flush() const {
         if (flags_ & XCB_GC_DASH_LIST) { v[cnt++] = dlist_; }
         if (flags_ & XCB_GC_ARC_MODE) { v[cnt++] = arcmode_; }
         xcb_change_gc(cx_, gc_, flags_, v);
+        if (counters_) { ++counters_->requests; ++counters_->gc_changes; }
+        valid_ |= flags_;
         flags_ = 0;
     }
 }
@@ -41,7 +41,7 @@ public:
 
     xcb_gcontext_t xid() const { return gc_; }
     void set_func(xcb_gx_t func);
-    xcb_gx_t func() { return func_; }
+    xcb_gx_t func() { return xcb_gx_t(func_); }
     void set_plane_mask(uint32_t pmask);
     void set_foreground(const Color & color);
     Color foreground() const;
@@ -62,14 +62,28 @@ public:
     void set_dash_offset(uint32_t ofs);
     void set_dash_list(uint32_t list);
     void set_arc_mode(uint32_t mode);
+
+    // Returns true if the clip rectangles already set to rs.
+    bool clip_equals(const xcb_rectangle_t * rs, std::size_t nrs) const;
+    void set_clip_rectangles(const xcb_rectangle_t * rs, std::size_t nrs, uint8_t ordering=XCB_CLIP_ORDERING_UNSORTED);
+
+    void set_counters(Xcb_counters * counters) { counters_ = counters; }
     void flush() const;
 
+private:
+
+    void change(uint32_t flag, uint32_t & value, uint32_t v);
+
 private:
 
     xcb_connection_t *  cx_ = nullptr;
     xcb_gcontext_t      gc_ = 0;
-    mutable uint32_t    flags_ = 0;
-    xcb_gx_t            func_ = XCB_GX_COPY;
+    mutable uint32_t    flags_ = 0;         // Pending changes.
+    mutable uint32_t    valid_ = 0;         // Values known to the server.
+    Xcb_counters *      counters_ = nullptr;
+    bool                clip_valid_ = false;
+    std::vector<xcb_rectangle_t> clip_rects_;
+    uint32_t            func_ = XCB_GX_COPY;
     uint32_t            pmask_ = XCB_NONE;
     uint32_t            fore_ = 0xffffffff;
     uint32_t            back_ = 0;
@@ -0,0 +1,249 @@
+// ----------------------------------------------------------------------------
+// Copyright © 2014-2023 Konstantin Shmelkov <mrcashe@gmail.com>.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+// PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+// OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+// WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+// OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+// EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+// ----------------------------------------------------------------------------
+
+
+#include <tau/exception.hh>
+#include <tau/locale.hh>
+#include <tau/string.hh>
+#include <tau/sys.hh>
+#include "glyph-cache-xcb.hh"
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <mutex>
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+
+// File layout, native byte order:
+//   Header, key (padded to 4 bytes), entries sorted by character, images.
+struct Header {
+    char        magic[8];
+    uint32_t    version;
+    uint32_t    key_len;
+    uint32_t    count;
+    uint32_t    data_ofs;
+    uint32_t    data_len;
+};
+
+const char      magic_[8] = { 't', 'a', 'u', 'g', 'l', 'y', 'p', 'h' };
+
+// Files written by other version are rejected.
+// Must be incremented when rasterizer output or file layout changes.
+const uint32_t  version_ = 2;
+
+// Limits the file size, glyphs beyond the limit are not saved.
+const std::size_t max_glyphs_ = 8192;
+
+// Files not used for that time are removed: font updated, size or resolution
+// no longer used. Used file gets its modification time refreshed once a day.
+const time_t max_age_ = 30*86400;
+const time_t touch_age_ = 86400;
+
+std::once_flag prune_once_;
+
+std::size_t pad4(std::size_t n) { return (n+3) & ~std::size_t(3); }
+
+// Removes stale files from cache directory, dir is in local encoding.
+void prune(const std::string & dir) {
+    DIR * d = opendir(dir.c_str());
+    if (!d) { return; }
+    time_t now = time(nullptr);
+
+    while (struct dirent * de = readdir(d)) {
+        struct stat st;
+
+        if (0 == fstatat(dirfd(d), de->d_name, &st, AT_SYMLINK_NOFOLLOW) && S_ISREG(st.st_mode) && now-st.st_mtime > max_age_) {
+            unlinkat(dirfd(d), de->d_name, 0);
+        }
+    }
+
+    closedir(d);
+}
+
+} // anonymous namespace
+
+namespace tau {
+
+Glyph_cache_xcb::Glyph_cache_xcb(const std::string & key):
+    key_(key)
+{
+    char name[32];
+    std::snprintf(name, sizeof name, "%016llx", static_cast<unsigned long long>(std::hash<std::string>()(key)));
+    dir_ = path_build(path_user_cache_dir(), "tau", "glyphs");
+    ustring path = path_build(dir_, name);
+    auto & io = Locale().iocharset();
+    path_ = io.is_utf8() ? std::string(path) : io.encode(path);
+    std::string dir = io.is_utf8() ? std::string(dir_) : io.encode(dir_);
+    std::call_once(prune_once_, prune, dir);
+    open();
+}
+
+Glyph_cache_xcb::~Glyph_cache_xcb() {
+    save();
+    if (map_) { munmap(map_, size_); }
+}
+
+// static
+bool Glyph_cache_xcb::enabled() {
+    return "0" != str_env("TAU_GLYPH_CACHE");
+}
+
+// private
+void Glyph_cache_xcb::open() {
+    int fd = ::open(path_.c_str(), O_RDONLY|O_CLOEXEC);
+    if (fd < 0) { return; }
+    struct stat st;
+    bool touch = false;
+
+    if (0 == fstat(fd, &st) && std::size_t(st.st_size) >= sizeof(Header)) {
+        touch = time(nullptr)-st.st_mtime > touch_age_;
+        void * p = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+
+        if (MAP_FAILED != p) {
+            map_ = p;
+            size_ = st.st_size;
+        }
+    }
+
+    close(fd);
+    if (!map_) { return; }
+
+    const char * b = static_cast<const char *>(map_);
+    const Header * hdr = reinterpret_cast<const Header *>(b);
+    std::size_t ofs = sizeof(Header)+pad4(hdr->key_len);
+    bool valid = 0 == std::memcmp(hdr->magic, magic_, sizeof magic_) && version_ == hdr->version
+        && hdr->key_len == key_.size() && ofs+hdr->count*sizeof(Entry) <= size_
+        && 0 == std::memcmp(b+sizeof(Header), key_.data(), key_.size())
+        && hdr->data_ofs >= ofs+hdr->count*sizeof(Entry) && hdr->data_ofs <= size_
+        && hdr->data_len <= size_-hdr->data_ofs;
+
+    if (valid) {
+        const Entry * e = reinterpret_cast<const Entry *>(b+ofs);
+
+        for (std::size_t n = 0; valid && n < hdr->count; ++n) {
+            valid = e[n].ofs <= hdr->data_len && bytes(e[n].info) <= hdr->data_len-e[n].ofs && (0 == n || e[n-1].wc < e[n].wc);
+        }
+
+        if (valid) {
+            entries_ = e;
+            count_ = hdr->count;
+            data_ = reinterpret_cast<const uint8_t *>(b+hdr->data_ofs);
+            if (touch) { utimensat(AT_FDCWD, path_.c_str(), nullptr, 0); }
+            return;
+        }
+    }
+
+    munmap(map_, size_);
+    map_ = nullptr;
+    size_ = 0;
+}
+
+const Glyph_cache_xcb::Entry * Glyph_cache_xcb::find(char32_t wc) const {
+    const Entry * end = entries_+count_;
+    const Entry * e = std::lower_bound(entries_, end, wc, [](const Entry & e, char32_t wc) { return e.wc < wc; });
+    return e != end && e->wc == wc ? e : nullptr;
+}
+
+void Glyph_cache_xcb::add(char32_t wc, const xcb_render_glyphinfo_t & info, const uint8_t * bits) {
+    if (count_+added_.size() < max_glyphs_ && !find(wc) && 0 == added_.count(wc)) {
+        Entry & e = added_[wc];
+        e.wc = wc;
+        e.ofs = added_bits_.size();
+        e.info = info;
+        added_bits_.insert(added_bits_.end(), bits, bits+bytes(info));
+    }
+}
+
+// Merges stored and added glyphs into temporary file,
+// which then renamed over the old one.
+void Glyph_cache_xcb::save() {
+    if (added_.empty()) { return; }
+    std::vector<Entry> v;
+    v.reserve(count_+added_.size());
+    std::size_t data_len = 0;
+    const Entry * e = entries_, * end = entries_+count_;
+
+    // Both sequences are sorted, so merge them keeping the order.
+    for (auto i = added_.begin(); e != end || i != added_.end(); ) {
+        if (i == added_.end() || (e != end && e->wc < i->first)) { v.push_back(*e++); }
+        else { v.push_back(i->second); ++i; }
+        v.back().ofs = data_len;
+        data_len += bytes(v.back().info);
+    }
+
+    Header hdr;
+    std::memcpy(hdr.magic, magic_, sizeof magic_);
+    hdr.version = version_;
+    hdr.key_len = key_.size();
+    hdr.count = v.size();
+    hdr.data_ofs = sizeof(Header)+pad4(key_.size())+v.size()*sizeof(Entry);
+    hdr.data_len = data_len;
+
+    std::string tmp = str_format(path_, '.', getpid());
+
+    try {
+        path_mkdir(dir_);
+        std::ofstream os(tmp, std::ios::binary);
+        const char zeros[4] = { 0, 0, 0, 0 };
+        os.write(reinterpret_cast<const char *>(&hdr), sizeof hdr);
+        os.write(key_.data(), key_.size());
+        os.write(zeros, pad4(key_.size())-key_.size());
+        os.write(reinterpret_cast<const char *>(v.data()), v.size()*sizeof(Entry));
+
+        for (const Entry & ve: v) {
+            auto i = added_.find(ve.wc);
+            const uint8_t * p = added_.end() != i ? added_bits_.data()+i->second.ofs : bits(*find(ve.wc));
+            os.write(reinterpret_cast<const char *>(p), bytes(ve.info));
+        }
+
+        os.close();
+
+        if (os.good() && 0 == std::rename(tmp.c_str(), path_.c_str())) {
+            added_.clear();
+            added_bits_.clear();
+            return;
+        }
+    }
+
+    catch (exception & x) {
+        std::cerr << "** Glyph_cache_xcb: failed to write glyph cache: " << x.what() << std::endl;
+    }
+
+    std::remove(tmp.c_str());
+}
+
+} // namespace tau
+
+//END
@@ -0,0 +1,98 @@
+// ----------------------------------------------------------------------------
+// Copyright © 2014-2023 Konstantin Shmelkov <mrcashe@gmail.com>.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+// PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+// OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+// WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+// OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+// EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+// ----------------------------------------------------------------------------
+
+
+#ifndef TAU_GLYPH_CACHE_XCB_HH
+#define TAU_GLYPH_CACHE_XCB_HH
+
+#include "types-xcb.hh"
+#include <xcb/render.h>
+#include <map>
+#include <vector>
+
+namespace tau {
+
+// Persistent cache of rasterized glyphs kept in path_user_cache_dir()/tau/glyphs,
+// one file per font face, size and resolution. The file is mapped into memory
+// when opened, glyphs added during the session are written back by save().
+// Files not used for 30 days are removed when the first cache is opened.
+// Setting TAU_GLYPH_CACHE environment variable to "0" disables the cache.
+class Glyph_cache_xcb {
+public:
+
+    struct Entry {
+        uint32_t                wc;
+        uint32_t                ofs;        // A8 image offset within data area.
+        xcb_render_glyphinfo_t  info;
+    };
+
+    // The key identifies font face, size and resolution.
+    explicit Glyph_cache_xcb(const std::string & key);
+    Glyph_cache_xcb(const Glyph_cache_xcb & other) = delete;
+    Glyph_cache_xcb & operator=(const Glyph_cache_xcb & other) = delete;
+   ~Glyph_cache_xcb();
+
+    static bool enabled();
+
+    // Image rows are padded to 4 bytes.
+    static std::size_t stride(const xcb_render_glyphinfo_t & info) { return (info.width+3) & ~3; }
+    static std::size_t bytes(const xcb_render_glyphinfo_t & info) { return stride(info)*info.height; }
+
+    // Finds glyph stored in the file, returns nullptr if not found.
+    const Entry * find(char32_t wc) const;
+
+    // Returns image of found glyph.
+    const uint8_t * bits(const Entry & e) const { return data_+e.ofs; }
+
+    // Adds glyph missing in the file.
+    void add(char32_t wc, const xcb_render_glyphinfo_t & info, const uint8_t * bits);
+
+    // Writes the file if something was added.
+    void save();
+
+private:
+
+    using Added = std::map<char32_t, Entry>;
+
+    std::string             key_;
+    ustring                 dir_;
+    std::string             path_;          // In local encoding.
+    void *                  map_ = nullptr;
+    std::size_t             size_ = 0;
+    const Entry *           entries_ = nullptr;
+    std::size_t             count_ = 0;
+    const uint8_t *         data_ = nullptr;
+    Added                   added_;
+    std::vector<uint8_t>    added_bits_;
+
+private:
+
+    void open();
+};
+
+} // namespace tau
+
+#endif // TAU_GLYPH_CACHE_XCB_HH
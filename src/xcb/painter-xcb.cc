@@ -33,6 +33,7 @@
 #include "pixmap-xcb.hh"
 #include "winface-xcb.hh"
 
+#include <cstring>
 #include <iostream>
 
 // ----------------------------------------------------------------------------
@@ -48,30 +49,132 @@ Painter_xcb::Painter_xcb(Winface_xcb * wf):
     xpicture_(wf->xpicture()),
     gc_(cx_, wf->wid())
 {
+    gc_.set_counters(&counters_);
     wstate().obscured_.set(wf->self()->size());
     wf->self()->signal_destroy().connect(fun(this, &Painter_xcb::on_destroy));
     select_font(Font::normal());
     update_clip();
 }
 
+Painter_xcb::~Painter_xcb() {
+    drop_mask();
+}
+
+// public
+void Painter_xcb::begin_frame() {
+    counters_ = Xcb_counters();
+    deferred_ = true;
+    pcr_valid_ = false;
+}
+
+// public
+const Xcb_counters & Painter_xcb::end_frame() {
+    flush_batch();
+    deferred_ = false;
+    pcr_valid_ = false;
+
+    if (XCB_NONE != xid_) {
+        xcb_flush(cx_);
+        ++counters_.flushes;
+    }
+
+    return counters_;
+}
+
+// public
+void Painter_xcb::set_target(xcb_drawable_t drw, xcb_render_picture_t pict) {
+    if (XCB_NONE != xid_ && (drw != xid_ || pict != xpicture_)) {
+        flush_batch();
+        xid_ = drw;
+        xpicture_ = pict;
+        pcr_valid_ = false;
+    }
+}
+
+// protected
+// Overrides Painter_impl.
+void Painter_xcb::commit() {
+    flush_batch();
+
+    if (!deferred_ && XCB_NONE != xid_) {
+        xcb_flush(cx_);
+        ++counters_.flushes;
+    }
+}
+
+// private
+void Painter_xcb::flush_batch() {
+    if (!batch_.empty()) {
+        if (XCB_NONE != xid_) {
+            gc_.set_foreground(batch_color_);
+            gc_.set_func(batch_func_);
+            gc_.flush();
+            xcb_poly_fill_rectangle(cx_, xid_, gc_.xid(), batch_.size(), batch_.data());
+            ++counters_.requests;
+            ++counters_.batches;
+        }
+
+        batch_.clear();
+    }
+}
+
+// private
+void Painter_xcb::push_rectangles(const xcb_rectangle_t * rs, std::size_t nrs, const Color & c) {
+    // Keeps the request well below of maximal request length.
+    const std::size_t max_batch = 4096;
+    xcb_gx_t func = gx_oper(state().op_);
+
+    if (!batch_.empty() && (func != batch_func_ || c.argb32() != batch_color_.argb32())) {
+        flush_batch();
+    }
+
+    batch_color_ = c;
+    batch_func_ = func;
+    batch_.insert(batch_.end(), rs, rs+nrs);
+    counters_.rects += nrs;
+    if (batch_.size() >= max_batch) { flush_batch(); }
+}
+
 void Painter_xcb::draw_pixmap(Pixmap_cptr pix, const Point & pix_origin, const Size & pix_size, const Point & pt, bool transparent) {
     if (XCB_NONE == xpicture_ || XCB_NONE == xid_) { return; }
     auto xpix = std::dynamic_pointer_cast<const Pixmap_xcb>(pix);
     if (!xpix || !xpix->size()) { return; }
+    flush_batch();
     xpix->set_display(dp_);
-    xpix->draw(xid_, xpicture_, state().op_, pix_origin, pix_size, pt, transparent);
+    counters_.requests += xpix->draw(xid_, xpicture_, state().op_, pix_origin, pix_size, pt, transparent);
 }
 
+// Only changed clip is sent to the server.
 void Painter_xcb::set_clip() {
     if (XCB_NONE != xpicture_) {
-        gc_.flush();
-        xcb_set_clip_rectangles(cx_, XCB_CLIP_ORDERING_UNSORTED, gc_.xid(), 0, 0, 1, &cr_);
-        xcb_render_set_picture_clip_rectangles(cx_, xpicture_, 0, 0, 1, &cr_);
+        if (!gc_.clip_equals(cr_.data(), cr_.size())) {
+            flush_batch();
+            gc_.set_clip_rectangles(cr_.data(), cr_.size(), XCB_CLIP_ORDERING_YX_BANDED);
+        }
+
+        if (!deferred_ || !pcr_valid_ || !xcb_rectangles_equal(pcr_.data(), pcr_.size(), cr_.data(), cr_.size())) {
+            xcb_render_set_picture_clip_rectangles(cx_, xpicture_, 0, 0, cr_.size(), cr_.data());
+            ++counters_.requests;
+            pcr_ = cr_;
+            pcr_valid_ = deferred_;
+        }
     }
 }
 
+// Overrides pure Painter_impl.
 void Painter_xcb::update_clip() {
-    cr_ = to_xcb_rectangle(wstate().obscured_);
+    cr_.clear();
+
+    if (const Region * rgn = damage()) {
+        Region clip(*rgn);
+        clip.intersect(wstate().obscured_);
+        for (const Region::Box & b: clip) { cr_.push_back(to_xcb_rectangle(Region::to_rect(b))); }
+    }
+
+    else {
+        cr_.push_back(to_xcb_rectangle(wstate().obscured_));
+    }
+
     set_clip();
 }
 
@@ -80,11 +183,60 @@ void Painter_xcb::fill_polygon(const Point * pts, std::size_t npts, const Color
     if (XCB_NONE == xid_) { return; }
     xcb_point_t xpts[npts];
     for (std::size_t n = 0; n < npts; ++n) { xpts[n] = to_xcb_point(pts[n]); }
+    flush_batch();
     gc_.set_foreground(color);
     gc_.set_func(gx_oper(state().op_));
     gc_.flush();
     xcb_fill_poly(cx_, xid_, gc_.xid(), XCB_POLY_SHAPE_COMPLEX, XCB_COORD_MODE_ORIGIN, npts, xpts);
-    xcb_flush(cx_);
+    ++counters_.requests;
+}
+
+// protected
+// Overrides Painter_impl.
+// Uploads the mask into scratch A8 pixmap and does single XRender composite.
+void Painter_xcb::fill_mask(const Rect & r, const uint8_t * mask, std::size_t stride, const Color & c) {
+    if (XCB_NONE == xpicture_ || XCB_NONE == xid_ || !r) { return; }
+    flush_batch();
+    unsigned w = r.width(), h = r.height();
+    std::size_t pad = (w+3) & ~std::size_t(3);
+
+    if (mask_size_.width() < w || mask_size_.height() < h) {
+        Size sz(std::max(w, mask_size_.width()), std::max(h, mask_size_.height()));
+        drop_mask();
+        mask_pixmap_ = xcb_generate_id(cx_);
+        xcb_create_pixmap(cx_, 8, mask_pixmap_, xid_, sz.width(), sz.height());
+        mask_gc_ = new Context_xcb(cx_, mask_pixmap_);
+        mask_picture_ = xcb_generate_id(cx_);
+        const uint32_t v[1] = { 0 };
+        xcb_render_create_picture(cx_, mask_picture_, mask_pixmap_, dp_->pictformat(8), 1, v);
+        mask_size_ = sz;
+    }
+
+    if (stride != pad) {
+        mask_buffer_.resize(pad*h);
+        for (unsigned y = 0; y < h; ++y) { std::memcpy(mask_buffer_.data()+y*pad, mask+y*stride, w); }
+        mask = mask_buffer_.data();
+    }
+
+    // Large masks are uploaded in bands to fit into maximal request length.
+    std::size_t max_bytes = 4*std::size_t(xcb_get_maximum_request_length(cx_));
+    unsigned band = max_bytes > 32+pad ? (max_bytes-32)/pad : 1;
+
+    for (unsigned y = 0; y < h; y += band) {
+        unsigned n = std::min(band, h-y);
+        xcb_put_image(cx_, XCB_IMAGE_FORMAT_Z_PIXMAP, mask_pixmap_, mask_gc_->xid(), w, n, 0, y, 0, 8, n*pad, mask+y*pad);
+        ++counters_.requests;
+    }
+
+    xcb_render_composite(cx_, xrender_oper(state().op_), dp_->solid_fill(c), mask_picture_, xpicture_, 0, 0, 0, 0, r.left(), r.top(), w, h);
+    ++counters_.requests;
+}
+
+void Painter_xcb::drop_mask() {
+    if (XCB_NONE != mask_picture_) { xcb_render_free_picture(cx_, mask_picture_); mask_picture_ = XCB_NONE; }
+    if (mask_gc_) { delete mask_gc_; mask_gc_ = nullptr; }
+    if (XCB_NONE != mask_pixmap_) { xcb_free_pixmap(cx_, mask_pixmap_); mask_pixmap_ = XCB_NONE; }
+    mask_size_.reset();
 }
 
 // protected
@@ -141,7 +293,7 @@ void Painter_xcb::stroke_prim_rect(const Prim_rect * po, std::size_t no) {
     if (nrs) {
         load_stroke_gc();
         xcb_poly_rectangle(cx_, xid_, gc_.xid(), nrs, rs);
-        xcb_flush(cx_);
+        ++counters_.requests;
     }
 }
 
@@ -177,11 +329,7 @@ void Painter_xcb::fill_prim_rect(const Prim_rect * po, std::size_t no) {
     }
 
     if (nrs) {
-        gc_.set_foreground(state().brush_->color);
-        gc_.set_func(gx_oper(state().op_));
-        gc_.flush();
-        xcb_poly_fill_rectangle(cx_, xid_, gc_.xid(), nrs, rs);
-        xcb_flush(cx_);
+        push_rectangles(rs, nrs, state().brush_->color);
     }
 }
 
@@ -192,11 +340,7 @@ void Painter_xcb::fill_rectangles(const Rect * rs, std::size_t nrs, const Color
     xcb_rectangle_t xr[nrs];
     std::size_t n = nrs;
     for (xcb_rectangle_t * p = xr; n; n--) { *p++ = to_xcb_rectangle(*rs++); }
-    gc_.set_foreground(c);
-    gc_.set_func(gx_oper(state().op_));
-    gc_.flush();
-    xcb_poly_fill_rectangle(cx_, xid_, gc_.xid(), nrs, xr);
-    xcb_flush(cx_);
+    push_rectangles(xr, nrs, c);
 }
 
 // protected
@@ -209,7 +353,8 @@ void Painter_xcb::stroke_prim_text(const Prim_text & o) {
     xcb_render_picture_t src = dp_->solid_fill(o.color);
     uint8_t op = xrender_oper(state().op_);
     set_clip();
-    fp->render_glyphs(o.str, pt-woffset(), op, src, xpicture_);
+    flush_batch();
+    counters_.requests += fp->render_glyphs(*this, o.str, pt-woffset(), op, src, xpicture_);
 }
 
 void Painter_xcb::stroke_rectangle(const Rect & r) {
@@ -217,7 +362,7 @@ void Painter_xcb::stroke_rectangle(const Rect & r) {
     xcb_rectangle_t xr = to_xcb_rectangle(r);
     load_stroke_gc();
     xcb_poly_rectangle(cx_, xid_, gc_.xid(), 1, &xr);
-    xcb_flush(cx_);
+    ++counters_.requests;
 }
 
 void Painter_xcb::stroke_polyline(const Point * pts, std::size_t npts) {
@@ -227,7 +372,7 @@ void Painter_xcb::stroke_polyline(const Point * pts, std::size_t npts) {
     for (xcb_point_t * p = xpts; n; n--) { *p++ = to_xcb_point(*pts++); }
     load_stroke_gc();
     xcb_poly_line(cx_, XCB_COORD_MODE_ORIGIN, xid_, gc_.xid(), npts, xpts);
-    xcb_flush(cx_);
+    ++counters_.requests;
 }
 
 void Painter_xcb::stroke_prim_arc(const Prim_arc & obj) {
@@ -243,7 +388,7 @@ void Painter_xcb::stroke_prim_arc(const Prim_arc & obj) {
         arc.angle2 = 3666.93*(obj.angle2-obj.angle1);
         load_stroke_gc();
         xcb_poly_arc(cx_, xid_, gc_.xid(), 1, &arc);
-        xcb_flush(cx_);
+        ++counters_.requests;
     }
 
     else {
@@ -252,6 +397,7 @@ void Painter_xcb::stroke_prim_arc(const Prim_arc & obj) {
 }
 
 void Painter_xcb::load_stroke_gc() {
+    flush_batch();
     gc_.set_foreground(state().pen_->color);
     double lw = state().pen_->line_width;
     gc_.set_line_width(lw > 0.0 ? lw : 1);
@@ -314,11 +460,7 @@ Vector Painter_xcb::text_size(const ustring & s) {
         h = std::ceil(fp->ascent()-fp->descent()+fp->linegap());
 
         for (char32_t wc: s) {
-            if (!char32_is_zerowidth(wc)) {
-                if (Glyph_ptr g = fp->glyph(wc)) {
-                    w += std::ceil(g->advance().x());
-                }
-            }
+            w += fp->advance(wc);
         }
     }
 
@@ -333,11 +475,7 @@ Vector Painter_xcb::text_size(const std::u32string & s) {
         h = std::ceil(fp->ascent()-fp->descent()+fp->linegap());
 
         for (char32_t wc: s) {
-            if (!char32_is_zerowidth(wc)) {
-                if (Glyph_ptr g = fp->glyph(wc)) {
-                    w += std::ceil(g->advance().x());
-                }
-            }
+            w += fp->advance(wc);
         }
     }
 
@@ -345,6 +483,7 @@ Vector Painter_xcb::text_size(const std::u32string & s) {
 }
 
 void Painter_xcb::on_destroy() {
+    batch_.clear();
     xpicture_ = XCB_NONE;
     xid_ = XCB_NONE;
 }
@@ -37,9 +37,25 @@ class Painter_xcb: public Painter_impl {
 public:
 
     explicit Painter_xcb(Winface_xcb * wf);
+   ~Painter_xcb();
+
+    // Starts the frame: requests are not flushed until end_frame() called.
+    void begin_frame();
+
+    // Sends pending requests, flushes connection once and returns frame statistics.
+    const Xcb_counters & end_frame();
+
+    // Overrides Painter_impl.
+    uint64_t requests() const override { return counters_.requests; }
+
+    // Redirects drawing into another drawable of the same depth, such as back buffer.
+    void set_target(xcb_drawable_t drw, xcb_render_picture_t pict);
 
 protected:
 
+    // Overrides Painter_impl.
+    void commit() override;
+
     // Overrides pure Painter_impl.
     Vector text_size(const ustring & s) override;
 
@@ -67,6 +83,9 @@ protected:
     // Overrides pure Painter_impl.
     void draw_pixmap(Pixmap_cptr pix, const Point & pix_origin, const Size & pix_size, const Point & pt, bool transparent) override;
 
+    // Overrides Painter_impl.
+    void fill_mask(const Rect & r, const uint8_t * mask, std::size_t stride, const Color & c) override;
+
     // Overrides Painter_impl.
     void fill_polygon(const Point * pts, std::size_t npts, const Color & color) override;
 
@@ -93,6 +112,9 @@ private:
     void set_clip();
     void on_destroy();
     void load_stroke_gc();
+    void drop_mask();
+    void push_rectangles(const xcb_rectangle_t * rs, std::size_t nrs, const Color & c);
+    void flush_batch();
 
 private:
 
@@ -101,7 +123,26 @@ private:
     xcb_drawable_t       xid_;
     xcb_render_picture_t xpicture_;
     Context_xcb          gc_;
-    xcb_rectangle_t      cr_;
+    std::vector<xcb_rectangle_t> cr_;           // Clip: obscured area within damaged region.
+    Xcb_counters         counters_;
+    bool                 deferred_ = false;     // Inside of begin_frame()/end_frame().
+
+    // Picture clip known to the server, valid during the frame only because
+    // window picture shared between painters.
+    std::vector<xcb_rectangle_t> pcr_;
+    bool                 pcr_valid_ = false;
+
+    // Pending same color rectangles, sent by single PolyFillRectangle request.
+    std::vector<xcb_rectangle_t> batch_;
+    Color                batch_color_;
+    xcb_gx_t             batch_func_ = XCB_GX_COPY;
+
+    // Scratch A8 pixmap used by fill_mask(), grows on demand.
+    xcb_pixmap_t         mask_pixmap_ = XCB_NONE;
+    xcb_render_picture_t mask_picture_ = XCB_NONE;
+    Context_xcb *        mask_gc_ = nullptr;
+    Size                 mask_size_;
+    std::vector<uint8_t> mask_buffer_;
 };
 
 } // namespace tau
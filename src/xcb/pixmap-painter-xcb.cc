@@ -27,9 +27,11 @@
 #include <tau/exception.hh>
 #include <tau/string.hh>
 #include <brush-impl.hh>
+#include <pen-impl.hh>
 #include <pixmap-impl.hh>
 #include <posix/theme-posix.hh>
 #include "pixmap-painter-xcb.hh"
+#include "pixmap-xcb.hh"
 #include "font-xcb.hh"
 
 namespace tau {
@@ -85,11 +87,7 @@ Vector Pixmap_painter_xcb::text_size(const ustring & s) {
         h = std::ceil(fp->ascent()-fp->descent()+fp->linegap());
 
         for (char32_t wc: s) {
-            if (!char32_is_zerowidth(wc)) {
-                if (Glyph_ptr g = fp->glyph(wc)) {
-                    w += std::ceil(g->advance().x());
-                }
-            }
+            w += fp->advance(wc);
         }
     }
 
@@ -104,46 +102,100 @@ Vector Pixmap_painter_xcb::text_size(const std::u32string & s) {
         h = std::ceil(fp->ascent()-fp->descent()+fp->linegap());
 
         for (char32_t wc: s) {
-            if (!char32_is_zerowidth(wc)) {
-                if (Glyph_ptr g = fp->glyph(wc)) {
-                    w += std::ceil(g->advance().x());
-                }
-            }
+            w += fp->advance(wc);
         }
     }
 
     return Vector(w, h);
 }
 
-// Overrides Painter_impl.
-void Pixmap_painter_xcb::paint() {
-    if (pixmap_) {
-        Rect r(0, 0, pixmap_->size());
-        fill_rectangles(&r, 1, state().brush_->color);
-    }
-}
-
 // Overrides pure Painter_impl.
 void Pixmap_painter_xcb::stroke_rectangle(const Rect & r) {
+    int x1 = r.x(), y1 = r.y(), x2 = x1+r.iwidth(), y2 = y1+r.iheight();
+    Point pts[5] = { Point(x1, y1), Point(x2, y1), Point(x2, y2), Point(x1, y2), Point(x1, y1) };
+    stroke_polyline(pts, 5);
 }
 
 // Overrides pure Painter_impl.
 void Pixmap_painter_xcb::stroke_polyline(const Point * pts, std::size_t npts) {
+    if (pixmap_ && npts > 1) {
+        std::vector<Contour> ctrs;
+        stroke_outline(pts, npts, ctrs);
+        raster_contours(ctrs.data(), ctrs.size(), state().pen_->color);
+    }
+}
+
+// Overrides Painter_impl.
+void Pixmap_painter_xcb::stroke_prim_rect(const Prim_rect * po, std::size_t no) {
+    Vector wo = woffset();
+
+    for (; no; --no, ++po) {
+        Point pts[5];
+        pts[0] = matrix()*po->v1-wo;
+        pts[1] = matrix()*Vector(po->v2.x(), po->v1.y())-wo;
+        pts[2] = matrix()*po->v2-wo;
+        pts[3] = matrix()*Vector(po->v1.x(), po->v2.y())-wo;
+        pts[4] = pts[0];
+        stroke_polyline(pts, 5);
+    }
+}
+
+// Overrides Painter_impl.
+void Pixmap_painter_xcb::fill_prim_rect(const Prim_rect * po, std::size_t no) {
+    Vector wo = woffset();
+
+    for (; no; --no, ++po) {
+        Point pts[4];
+        pts[0] = matrix()*po->v1-wo;
+        pts[1] = matrix()*Vector(po->v2.x(), po->v1.y())-wo;
+        pts[2] = matrix()*po->v2-wo;
+        pts[3] = matrix()*Vector(po->v1.x(), po->v2.y())-wo;
+
+        if (Rect r = is_rect(pts, 4)) { fill_rectangles(&r, 1, state().brush_->color); }
+        else { fill_polygon(pts, 4, state().brush_->color); }
+    }
 }
 
 // Overrides pure Painter_impl.
 void Pixmap_painter_xcb::fill_rectangles(const Rect * rs, std::size_t nrs, const Color & c) {
-    if (pixmap_) {
-        pixmap_->fill_rectangles(rs, nrs, c);
+    if (auto pix = dynamic_cast<Pixmap_xcb *>(pixmap_)) {
+        std::vector<Rect> v;
+        v.reserve(nrs);
+        for (; nrs; --nrs, ++rs) { if (Rect r = *rs & wstate().obscured_) { v.push_back(r); } }
+        if (!v.empty()) { pix->fill_rectangles(v.data(), v.size(), c, state().op_); }
+    }
+}
+
+// Overrides Painter_impl.
+void Pixmap_painter_xcb::fill_mask(const Rect & r, const uint8_t * mask, std::size_t stride, const Color & c) {
+    if (auto pix = dynamic_cast<Pixmap_xcb *>(pixmap_)) {
+        pix->fill_mask(r, mask, stride, c, state().op_);
     }
 }
 
 // Overrides pure Painter_impl.
 void Pixmap_painter_xcb::fill_polygon(const Point * pts, std::size_t npts, const Color & color) {
+    if (pixmap_ && npts > 2) {
+        Vector start(pts[0]);
+        Contour ctr(start);
+        for (std::size_t i = 1; i < npts; ++i) { ctr.line_to(Vector(pts[i])); }
+        raster_contours(&ctr, 1, color);
+    }
 }
 
 // Overrides pure Painter_impl.
 void Pixmap_painter_xcb::draw_pixmap(Pixmap_cptr pix, const Point & pix_origin, const Size & pix_size, const Point & pt, bool transparent) {
+    auto dst = dynamic_cast<Pixmap_xcb *>(pixmap_);
+    auto src = std::dynamic_pointer_cast<const Pixmap_xcb>(pix);
+
+    if (dst && src && dst != src.get()) {
+        Rect r = Rect(pt, pix_size) & wstate().obscured_;
+
+        if (r) {
+            Point d = r.origin()-pt;
+            dst->blit(*src, pix_origin+d, r.size(), r.origin(), transparent, state().op_);
+        }
+    }
 }
 
 } // namespace tau
@@ -44,9 +44,6 @@ public:
 
 protected:
 
-    // Overrides Painter_impl.
-    void paint() override;
-
     // Overrides pure Painter_impl.
     void stroke_rectangle(const Rect & r) override;
 
@@ -56,9 +53,18 @@ protected:
     // Overrides pure Painter_impl.
     void fill_rectangles(const Rect * rs, std::size_t nrs, const Color & color) override;
 
+    // Overrides Painter_impl.
+    void fill_mask(const Rect & r, const uint8_t * mask, std::size_t stride, const Color & color) override;
+
     // Overrides pure Painter_impl.
     void fill_polygon(const Point * pts, std::size_t npts, const Color & color) override;
 
+    // Overrides Painter_impl.
+    void stroke_prim_rect(const Prim_rect * po, std::size_t no) override;
+
+    // Overrides Painter_impl.
+    void fill_prim_rect(const Prim_rect * po, std::size_t no) override;
+
     // Overrides pure Painter_impl.
     void draw_pixmap(Pixmap_cptr pix, const Point & pix_origin, const Size & pix_size, const Point & pt, bool transparent) override;
 
@@ -27,8 +27,79 @@
 #include <tau/string.hh>
 #include "pixmap-xcb.hh"
 #include "display-xcb.hh"
+#include <algorithm>
 #include <cstring>
 #include <iostream>
+#include <vector>
+
+namespace {
+
+inline uint8_t blend8(unsigned src, unsigned dst, unsigned alpha) {
+    return (src*alpha+dst*(255-alpha)+127)/255;
+}
+
+// Composite single 24 or 32 bit pixel stored as BGRA, m is the coverage.
+// OPER_COPY blends source over destination, OPER_SOURCE replaces it.
+inline void comp32(uint8_t * d, uint32_t argb, unsigned m, tau::Oper op, bool alpha) {
+    unsigned sa = argb >> 24, sr = 0xff & (argb >> 16), sg = 0xff & (argb >> 8), sb = 0xff & argb;
+
+    switch (op) {
+        case tau::OPER_COPY:
+            if (alpha) { m = (m*sa+127)/255; }
+            if (0 == m) { return; }
+            d[0] = blend8(sb, d[0], m); d[1] = blend8(sg, d[1], m); d[2] = blend8(sr, d[2], m);
+            if (alpha) { d[3] = m+(d[3]*(255-m)+127)/255; }
+            break;
+
+        case tau::OPER_SOURCE:
+            d[0] = blend8(sb, d[0], m); d[1] = blend8(sg, d[1], m); d[2] = blend8(sr, d[2], m);
+            if (alpha) { d[3] = blend8(sa, d[3], m); }
+            break;
+
+        case tau::OPER_CLEAR:
+            d[0] = blend8(0, d[0], m); d[1] = blend8(0, d[1], m); d[2] = blend8(0, d[2], m);
+            if (alpha) { d[3] = blend8(0, d[3], m); }
+            break;
+
+        case tau::OPER_SET:
+            d[0] = blend8(255, d[0], m); d[1] = blend8(255, d[1], m); d[2] = blend8(255, d[2], m);
+            if (alpha) { d[3] = blend8(255, d[3], m); }
+            break;
+
+        case tau::OPER_XOR:
+            if (m >= 128) { d[0] ^= sb; d[1] ^= sg; d[2] ^= sr; }
+            break;
+
+        case tau::OPER_NOT:
+            if (m >= 128) { d[0] = ~d[0]; d[1] = ~d[1]; d[2] = ~d[2]; }
+            break;
+    }
+}
+
+inline void comp8(uint8_t * d, unsigned gray, unsigned m, tau::Oper op) {
+    switch (op) {
+        case tau::OPER_COPY:
+        case tau::OPER_SOURCE: *d = blend8(gray, *d, m); break;
+        case tau::OPER_CLEAR: *d = blend8(0, *d, m); break;
+        case tau::OPER_SET: *d = blend8(255, *d, m); break;
+        case tau::OPER_XOR: if (m >= 128) { *d ^= gray; } break;
+        case tau::OPER_NOT: if (m >= 128) { *d = ~*d; } break;
+    }
+}
+
+inline uint32_t comp1(uint32_t dst, uint32_t argb, tau::Oper op) {
+    uint32_t src = 0 != (0xffffff & argb) ? 1 : 0;
+
+    switch (op) {
+        case tau::OPER_CLEAR: return 0;
+        case tau::OPER_SET: return 1;
+        case tau::OPER_XOR: return dst ^ src;
+        case tau::OPER_NOT: return dst ? 0 : 1;
+        default: return src;
+    }
+}
+
+} // anonymous namespace
 
 namespace tau {
 
@@ -177,7 +248,145 @@ void Pix_store::fill_rectangle(const Point & pt, const Size & sz, uint32_t rgb)
         sindex = (pt.y()*stride_)+(pt.x() << 2);
 
         for (; sindex < rbytes && 0 != height; sindex += stride_, --height) {
-            std::wmemset(reinterpret_cast<wchar_t *>(raw_.data()+sindex), rgb, sz.width());
+            std::fill_n(reinterpret_cast<uint32_t *>(raw_.data()+sindex), sz.width(), rgb);
+        }
+    }
+}
+
+// The mask covers sz pixels, mask rows are stride bytes apart.
+// Null mask means full coverage.
+void Pix_store::composite(const Point & pt, const Size & sz, const uint8_t * mask, std::size_t stride, uint32_t argb, Oper op) {
+    int x0 = std::max(0, pt.x()), y0 = std::max(0, pt.y());
+    int x1 = std::min(sz_.iwidth(), pt.x()+sz.iwidth());
+    int y1 = std::min(sz_.iheight(), pt.y()+sz.iheight());
+    if (x0 >= x1 || y0 >= y1 || raw_.empty()) { return; }
+    if (mask) { mask += (y0-pt.y())*stride+(x0-pt.x()); }
+    int w = x1-x0;
+
+    if (1 == depth_) {
+        for (int y = y0; y < y1; ++y) {
+            for (int x = x0; x < x1; ++x) {
+                if (!mask || mask[(y-y0)*stride+(x-x0)] >= 128) {
+                    put_pixel(Point(x, y), comp1(get_pixel(Point(x, y)), argb, op));
+                }
+            }
+        }
+
+        return;
+    }
+
+    if (8 == depth_) {
+        unsigned gray = Color::from_argb32(argb).gray8();
+
+        for (int y = y0; y < y1; ++y) {
+            uint8_t * d = raw_.data()+y*stride_+x0;
+
+            if (!mask && (OPER_SOURCE == op || OPER_COPY == op)) { std::memset(d, gray, w); }
+            else if (!mask && OPER_CLEAR == op) { std::memset(d, 0, w); }
+            else if (!mask && OPER_SET == op) { std::memset(d, 0xff, w); }
+
+            else {
+                const uint8_t * m = mask ? mask+(y-y0)*stride : nullptr;
+                for (int x = 0; x < w; ++x, ++d) { comp8(d, gray, m ? m[x] : 255, op); }
+            }
+        }
+
+        return;
+    }
+
+    unsigned sa = argb >> 24;
+    bool alpha = 32 == depth_;
+    uint32_t fill = OPER_CLEAR == op ? 0 : (OPER_SET == op ? 0xffffffff : argb);
+    bool solid = !mask && (OPER_SOURCE == op || OPER_CLEAR == op || OPER_SET == op || (OPER_COPY == op && (255 == sa || !alpha)));
+
+    for (int y = y0; y < y1; ++y) {
+        uint8_t * d = raw_.data()+y*stride_+(x0 << 2);
+
+        if (solid) {
+            std::fill_n(reinterpret_cast<uint32_t *>(d), w, fill);
+        }
+
+        else {
+            const uint8_t * m = mask ? mask+(y-y0)*stride : nullptr;
+
+            for (int x = 0; x < w; ++x, d += 4) {
+                if (unsigned a = m ? m[x] : 255) { comp32(d, argb, a, op, alpha); }
+            }
+        }
+    }
+}
+
+// Source rows are converted to ARGB and composited as spans,
+// same depth opaque copies are done by rows.
+void Pix_store::blit(const Pix_store & src, const Point & src_pos, const Size & sz, const Point & pt, bool transparent, Oper op) {
+    int sx = src_pos.x(), sy = src_pos.y(), x0 = pt.x(), y0 = pt.y();
+    int w = std::min(sz.iwidth(), src.sz_.iwidth()-sx), h = std::min(sz.iheight(), src.sz_.iheight()-sy);
+    if (x0 < 0) { sx -= x0; w += x0; x0 = 0; }
+    if (y0 < 0) { sy -= y0; h += y0; y0 = 0; }
+    if (sx < 0) { x0 -= sx; w += sx; sx = 0; }
+    if (sy < 0) { y0 -= sy; h += sy; sy = 0; }
+    w = std::min(w, sz_.iwidth()-x0);
+    h = std::min(h, sz_.iheight()-y0);
+    if (w <= 0 || h <= 0 || raw_.empty() || src.raw_.empty()) { return; }
+    bool src_alpha = transparent && 32 == src.depth_;
+
+    if (depth_ >= 24 && src.depth_ >= 24 && !src_alpha && (OPER_COPY == op || OPER_SOURCE == op)) {
+        for (int y = 0; y < h; ++y) {
+            uint8_t * d = raw_.data()+(y0+y)*stride_+(x0 << 2);
+            std::memcpy(d, src.raw_.data()+(sy+y)*src.stride_+(sx << 2), w << 2);
+
+            // Source treated as opaque.
+            if (32 == depth_) {
+                for (int x = 0; x < w; ++x) { d[3+(x << 2)] = 0xff; }
+            }
+        }
+
+        return;
+    }
+
+    std::vector<uint32_t> span(w);
+
+    for (int y = 0; y < h; ++y) {
+        if (src.depth_ >= 24) {
+            const uint8_t * s = src.raw_.data()+(sy+y)*src.stride_+(sx << 2);
+
+            for (int x = 0; x < w; ++x, s += 4) {
+                uint32_t c = (uint32_t(s[3]) << 24)|(uint32_t(s[2]) << 16)|(uint32_t(s[1]) << 8)|s[0];
+                span[x] = src_alpha ? c : 0xff000000|c;
+            }
+        }
+
+        else if (8 == src.depth_) {
+            const uint8_t * s = src.raw_.data()+(sy+y)*src.stride_+sx;
+
+            for (int x = 0; x < w; ++x) {
+                uint32_t c = s[x];
+                span[x] = 0xff000000|(c << 16)|(c << 8)|c;
+            }
+        }
+
+        else {
+            for (int x = 0; x < w; ++x) {
+                span[x] = src.get_pixel(Point(sx+x, sy+y)) ? 0xffffffff : 0xff000000;
+            }
+        }
+
+        if (1 == depth_) {
+            for (int x = 0; x < w; ++x) {
+                Point p(x0+x, y0+y);
+                put_pixel(p, comp1(get_pixel(p), span[x], op));
+            }
+        }
+
+        else if (8 == depth_) {
+            uint8_t * d = raw_.data()+(y0+y)*stride_+x0;
+            for (int x = 0; x < w; ++x) { comp8(d+x, Color::from_argb32(span[x]).gray8(), 255, op); }
+        }
+
+        else {
+            uint8_t * d = raw_.data()+(y0+y)*stride_+(x0 << 2);
+            bool alpha = 32 == depth_;
+            for (int x = 0; x < w; ++x, d += 4) { comp32(d, span[x], 255, op, alpha); }
         }
     }
 }
@@ -493,7 +702,7 @@ void Pixmap_xcb::put_pixel_v(const Point & pt, const Color & c) {
     uint32_t argb = c.argb32();
     if (8 == sys.store_->depth_) { argb = c.gray8(); }
     sys.store_->put_pixel(pt, argb);
-    drop_cache();
+    touch();
     signal_changed_();
 }
 
@@ -501,15 +710,33 @@ void Pixmap_xcb::put_pixel_v(const Point & pt, const Color & c) {
 void Pixmap_xcb::fill_rectangles(const Rect * rs, std::size_t nrs, const Color & c) {
     uint32_t argb = c.argb32();
     if (8 == sys.store_->depth_) { argb = c.gray8(); }
-    sys.store_->fill_rectangle(rs->origin(), rs->size(), argb);
-    drop_cache();
+    for (; nrs; --nrs, ++rs) { sys.store_->fill_rectangle(rs->origin(), rs->size(), argb); }
+    touch();
+    signal_changed_();
+}
+
+void Pixmap_xcb::fill_mask(const Rect & r, const uint8_t * mask, std::size_t stride, const Color & c, Oper op) {
+    sys.store_->composite(r.origin(), r.size(), mask, stride, c.argb32(), op);
+    touch();
+    signal_changed_();
+}
+
+void Pixmap_xcb::fill_rectangles(const Rect * rs, std::size_t nrs, const Color & c, Oper op) {
+    for (; nrs; --nrs, ++rs) { sys.store_->composite(rs->origin(), rs->size(), nullptr, 0, c.argb32(), op); }
+    touch();
+    signal_changed_();
+}
+
+void Pixmap_xcb::blit(const Pixmap_xcb & src, const Point & pix_origin, const Size & pix_size, const Point & pt, bool transparent, Oper op) {
+    sys.store_->blit(*src.sys.store_, pix_origin, pix_size, pt, transparent, op);
+    touch();
     signal_changed_();
 }
 
 // Overrides pure Pixmap_impl.
 void Pixmap_xcb::set_argb32(const Point & pt, const uint8_t * buffer, std::size_t nbytes) {
     sys.store_->set_argb32(pt, buffer, nbytes);
-    drop_cache();
+    touch();
     signal_changed_();
 }
 
@@ -521,22 +748,37 @@ void Pixmap_xcb::set_display(Display_xcb_ptr dp) const {
     }
 }
 
-void Pixmap_xcb::drop_cache() const {
+void Pixmap_xcb::drop_mask() const {
     if (XCB_NONE != sys.mask_picture_) {
         if (sys.cx_) { xcb_render_free_picture(sys.cx_, sys.mask_picture_); }
         sys.mask_picture_ = XCB_NONE;
     }
 
-    if (XCB_NONE != sys.picture_) {
-        if (sys.cx_) { xcb_render_free_picture(sys.cx_, sys.picture_); }
-        sys.picture_ = XCB_NONE;
-    }
-
     if (XCB_NONE != sys.mask_pixmap_) {
         if (sys.cx_) { xcb_free_pixmap(sys.cx_, sys.mask_pixmap_); }
         sys.mask_pixmap_ = XCB_NONE;
     }
 
+    if (sys.gcm_) {
+        delete sys.gcm_;
+        sys.gcm_ = nullptr;
+    }
+}
+
+// Content changed but size is not: server side pixmap will be reused and uploaded again.
+void Pixmap_xcb::touch() const {
+    sys.dirty_ = true;
+    drop_mask();
+}
+
+void Pixmap_xcb::drop_cache() const {
+    drop_mask();
+
+    if (XCB_NONE != sys.picture_) {
+        if (sys.cx_) { xcb_render_free_picture(sys.cx_, sys.picture_); }
+        sys.picture_ = XCB_NONE;
+    }
+
     if (XCB_NONE != sys.pixmap_) {
         if (sys.cx_) { xcb_free_pixmap(sys.cx_, sys.pixmap_); }
         sys.pixmap_ = XCB_NONE;
@@ -547,39 +789,72 @@ void Pixmap_xcb::drop_cache() const {
         sys.gc_ = nullptr;
     }
 
-    if (sys.gcm_) {
-        delete sys.gcm_;
-        sys.gcm_ = nullptr;
-    }
+    sys.dirty_ = false;
 }
 
-void Pixmap_xcb::put(uint8_t str_format, xcb_drawable_t drw, const Context_xcb * gc, const Size & sz, const Point & dst_pos, uint8_t left_pad, uint8_t depth, uint32_t data_len, const uint8_t * data) const {
+// Large Z format images are transferred through MIT-SHM segment when available.
+unsigned Pixmap_xcb::put(uint8_t str_format, xcb_drawable_t drw, const Context_xcb * gc, const Size & sz, const Point & dst_pos, uint8_t left_pad, uint8_t depth, uint32_t data_len, const uint8_t * data) const {
+    unsigned h = sz.height();
+    if (0 == h || 0 == data_len) { return 0; }
     gc->flush();
-    xcb_put_image(sys.cx_, str_format, drw, gc->xid(), sz.width(), sz.height(), dst_pos.x(), dst_pos.y(), left_pad, depth, data_len, data);
-    xcb_flush(sys.cx_);
+    std::size_t stride = data_len/h;
+
+    // Small images are cheaper to send inline.
+    if (XCB_IMAGE_FORMAT_Z_PIXMAP == str_format && data_len >= 65536) {
+        if (uint8_t * shm = sys.dp_->shm_map(data_len)) {
+            // Rows are padded to 4 bytes, so total width is the stride in pixels.
+            uint16_t total_width = stride/(8 == depth ? 1 : 4);
+            std::memcpy(shm, data, data_len);
+            xcb_shm_put_image(sys.cx_, drw, gc->xid(), total_width, h, 0, 0, sz.width(), h, dst_pos.x(), dst_pos.y(), depth, str_format, 0, sys.dp_->shm_seg(), 0);
+            sys.dp_->shm_fence();
+            return 2;
+        }
+    }
+
+    // Otherwise image is sent in bands to fit into maximal request length.
+    std::size_t max_bytes = 4*std::size_t(xcb_get_maximum_request_length(sys.cx_));
+    unsigned band = max_bytes > 32+stride ? (max_bytes-32)/stride : 1;
+    unsigned nreq = 0;
+
+    for (unsigned y = 0; y < h; y += band, ++nreq) {
+        unsigned n = std::min(band, h-y);
+        xcb_put_image(sys.cx_, str_format, drw, gc->xid(), sz.width(), n, dst_pos.x(), dst_pos.y()+y, left_pad, depth, n*stride, data+y*stride);
+    }
+
+    return nreq;
 }
 
-void Pixmap_xcb::draw(xcb_drawable_t drw, xcb_render_picture_t pict, Oper op, const Point & pix_origin, const Size & pix_size, const Point & pt, bool transparent) const {
-    if (!sys.dp_ || !sys.store_) { return; }
+// Uploads store into the server side pixmap, converting it to the screen depth if needed.
+unsigned Pixmap_xcb::upload() const {
+    sys.dirty_ = false;
+
+    if (sys.dp_->depth() != depth()) {
+        Pix_store pm(sys.dp_->depth(), size());
+        sys.store_->convert(pm);
+        return put(pm.format_, sys.pixmap_, sys.gc_, size(), Point(), 0, pm.depth_, pm.raw_.size(), pm.raw_.data());
+    }
+
+    return put(sys.store_->format_, sys.pixmap_, sys.gc_, size(), Point(), 0, depth(), bytes(), raw());
+}
+
+unsigned Pixmap_xcb::draw(xcb_drawable_t drw, xcb_render_picture_t pict, Oper op, const Point & pix_origin, const Size & pix_size, const Point & pt, bool transparent) const {
+    if (!sys.dp_ || !sys.store_) { return 0; }
+    unsigned nreq = 1;
 
     if (XCB_NONE == sys.pixmap_) {
         sys.pixmap_ = xcb_generate_id(sys.cx_);
         xcb_create_pixmap(sys.cx_, sys.dp_->depth(), sys.pixmap_, drw, size().width(), size().height());
         sys.gc_ = new Context_xcb(sys.cx_, sys.pixmap_);
+        nreq += 3;
 
         sys.picture_ = xcb_generate_id(sys.cx_);
         const uint32_t v[1] = { 0 };
         xcb_render_create_picture(sys.cx_, sys.picture_, sys.pixmap_, sys.dp_->pictformat(), 1, v);
+        nreq += upload();
+    }
 
-        if (sys.dp_->depth() != depth()) {
-            Pix_store pm(sys.dp_->depth(), size());
-            sys.store_->convert(pm);
-            put(pm.format_, sys.pixmap_, sys.gc_, size(), Point(), 0, pm.depth_, pm.raw_.size(), pm.raw_.data());
-        }
-
-        else {
-            put(sys.store_->format_, sys.pixmap_, sys.gc_, size(), Point(), 0, depth(), bytes(), raw());
-        }
+    else if (sys.dirty_) {
+        nreq += upload();
     }
 
     xcb_render_picture_t pmask = XCB_NONE;
@@ -598,7 +873,7 @@ void Pixmap_xcb::draw(xcb_drawable_t drw, xcb_render_picture_t pict, Oper op, co
                 }
             }
 
-            put(xpm.format_, sys.mask_pixmap_, sys.gcm_, size(), Point(), 0, 1, xpm.raw_.size(), xpm.raw_.data());
+            nreq += 3+put(xpm.format_, sys.mask_pixmap_, sys.gcm_, size(), Point(), 0, 1, xpm.raw_.size(), xpm.raw_.data());
             sys.mask_picture_ = xcb_generate_id(sys.cx_);
             const uint32_t v[1] = { 0 };
             xcb_render_create_picture(sys.cx_, sys.mask_picture_, sys.mask_pixmap_, sys.dp_->pictformat(1), 1, v);
@@ -608,7 +883,7 @@ void Pixmap_xcb::draw(xcb_drawable_t drw, xcb_render_picture_t pict, Oper op, co
     }
 
     xcb_render_composite(sys.cx_, xrender_oper(op), sys.picture_, pmask, pict, pix_origin.x(), pix_origin.y(), 0, 0, pt.x(), pt.y(), pix_size.width(), pix_size.height());
-    xcb_flush(sys.cx_);
+    return nreq;
 }
 
 } // namespace tau
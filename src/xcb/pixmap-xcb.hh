@@ -48,6 +48,8 @@ struct Pix_store {
     uint32_t get_pixel(const Point & pt) const;
     void put_pixel(const Point & pt, uint32_t rgb);
     void fill_rectangle(const Point & pt, const Size & sz, uint32_t on);
+    void composite(const Point & pt, const Size & sz, const uint8_t * mask, std::size_t stride, uint32_t argb, Oper op);
+    void blit(const Pix_store & src, const Point & src_pos, const Size & sz, const Point & pt, bool transparent, Oper op);
     void set_argb32(const Point & pt, const uint8_t * buffer, std::size_t nbytes);
 
     void to_mono(Pix_store & xp) const;
@@ -68,6 +70,7 @@ struct Pixmap_sys {
     Pix_store *             store_ = nullptr;
     Context_xcb *           gc_  = nullptr;
     Context_xcb *           gcm_ = nullptr;
+    bool                    dirty_ = false;     // Server side pixmap needs upload.
 };
 
 // ----------------------------------------------------------------------------
@@ -109,9 +112,19 @@ public:
     // Overrides pure Pixmap_impl.
     void fill_rectangles(const Rect * rs, std::size_t nrs, const Color & c) override;
 
+    // Composite solid color through A8 coverage mask.
+    void fill_mask(const Rect & r, const uint8_t * mask, std::size_t stride, const Color & c, Oper op=OPER_COPY);
+
+    // Composite solid color using given operator.
+    void fill_rectangles(const Rect * rs, std::size_t nrs, const Color & c, Oper op);
+
+    // Composite part of other pixmap, the source alpha used when transparent is true.
+    void blit(const Pixmap_xcb & src, const Point & pix_origin, const Size & pix_size, const Point & pt, bool transparent, Oper op);
+
     void set_display(Display_xcb_ptr dp) const;
 
-    void draw(xcb_drawable_t drw, xcb_render_picture_t pict, Oper op, const Point & pix_origin, const Size & pix_size, const Point & pt, bool transparent) const;
+    // Returns number of requests issued, does not flush connection.
+    unsigned draw(xcb_drawable_t drw, xcb_render_picture_t pict, Oper op, const Point & pix_origin, const Size & pix_size, const Point & pt, bool transparent) const;
 
 private:
 
@@ -120,7 +133,10 @@ private:
 private:
 
     void drop_cache() const;
-    void put(uint8_t format, xcb_drawable_t drw, const Context_xcb * gc, const Size & sz, const Point & dst_pos, uint8_t left_pad, uint8_t depth, uint32_t data_len, const uint8_t * data) const;
+    void drop_mask() const;
+    void touch() const;
+    unsigned upload() const;
+    unsigned put(uint8_t format, xcb_drawable_t drw, const Context_xcb * gc, const Size & sz, const Point & dst_pos, uint8_t left_pad, uint8_t depth, uint32_t data_len, const uint8_t * data) const;
 };
 
 } // namespace tau
@@ -102,11 +102,29 @@ class Dialog_xcb;
 using Dialog_xcb_ptr = std::shared_ptr<Dialog_xcb>;
 using Dialog_xcb_cptr = std::shared_ptr<const Dialog_xcb>;
 
+class Context_xcb;
+
 class Winface_xcb;
 using Winface_xcb_ptr = std::shared_ptr<Winface_xcb>;
 using Winface_xcb_cptr = std::shared_ptr<const Winface_xcb>;
 
+// Paint statistics, collected per frame.
+struct Xcb_counters {
+    unsigned    requests = 0;       // X requests issued.
+    unsigned    flushes = 0;        // xcb_flush() calls.
+    unsigned    gc_changes = 0;     // ChangeGC requests sent.
+    unsigned    gc_skipped = 0;     // Redundant GC changes dropped.
+    unsigned    rects = 0;          // Rectangles filled.
+    unsigned    batches = 0;        // PolyFillRectangle requests used for them.
+    unsigned    damage_rects = 0;   // Rectangles in damaged region.
+    uint64_t    requested_px = 0;   // Pixels invalidated, overlaps counted every time.
+    uint64_t    damaged_px = 0;     // Pixels in damaged region, those are repainted.
+    uint64_t    bounds_px = 0;      // Pixels in bounds of damaged region.
+};
+
 xcb_render_color_t x11_render_color(const Color & color);
+bool xcb_rectangles_equal(const xcb_rectangle_t & r1, const xcb_rectangle_t & r2);
+bool xcb_rectangles_equal(const xcb_rectangle_t * rs1, std::size_t n1, const xcb_rectangle_t * rs2, std::size_t n2);
 ustring x11_error_msg(int error);
 xcb_point_t to_xcb_point(const Point & pt);
 xcb_rectangle_t to_xcb_rectangle(const Rect & r);
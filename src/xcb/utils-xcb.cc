@@ -41,6 +41,16 @@ xcb_render_color_t x11_render_color(const Color & color) {
     return rc;
 }
 
+bool xcb_rectangles_equal(const xcb_rectangle_t & r1, const xcb_rectangle_t & r2) {
+    return r1.x == r2.x && r1.y == r2.y && r1.width == r2.width && r1.height == r2.height;
+}
+
+bool xcb_rectangles_equal(const xcb_rectangle_t * rs1, std::size_t n1, const xcb_rectangle_t * rs2, std::size_t n2) {
+    if (n1 != n2) { return false; }
+    for (std::size_t n = 0; n < n1; ++n) { if (!xcb_rectangles_equal(rs1[n], rs2[n])) { return false; } }
+    return true;
+}
+
 ustring x11_error_msg(int code) {
     static const std::map<int, ustring> errors = {
         { XCB_CONN_ERROR, "connection error" },
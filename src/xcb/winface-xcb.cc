@@ -26,6 +26,7 @@
 
 #include <tau/exception.hh>
 #include <tau/loop.hh>
+#include <tau/sys.hh>
 #include <tau/timeval.hh>
 #include <theme-impl.hh>
 #include <toplevel-impl.hh>
@@ -33,6 +34,7 @@
 #include "cursor-xcb.hh"
 #include "painter-xcb.hh"
 #include "pixmap-xcb.hh"
+#include <cstdlib>
 #include "winface-xcb.hh"
 #include <unistd.h>
 #include <xcb/xfixes.h>
@@ -111,6 +113,8 @@ void Winface_xcb::init(Window_impl * wii, const Point & upos, const Size & usize
 }
 
 Winface_xcb::~Winface_xcb() {
+    drop_back();
+    if (scroll_gc_) { delete scroll_gc_; }
     if (XCB_NONE != sync_counter_) { xcb_sync_destroy_counter(cx_, sync_counter_); }
     xcb_destroy_window(cx_, wid_);
     xcb_flush(cx_);
@@ -173,42 +177,173 @@ void Winface_xcb::grab_mouse() {
 
 void Winface_xcb::invalidate(const Rect & r) {
     if (r) {
-        for (Rect & inval: invals_) {
-            if (!inval) { inval = r; goto start; }
-            if (inval & r) { inval |= r; goto start; }
+        damage_.unite(r);
+        requested_ += uint64_t(r.width())*r.height();
+        paint_timer_.start(33);
+    }
+}
+
+// Overrides pure Winface.
+// Pixels are copied by the server, damage pending within the area moves along with them.
+// Without back buffer, parts of the window not available for copying are reported
+// by GraphicsExpose events and invalidated by handle_graphics_expose().
+bool Winface_xcb::scroll(const Rect & area, const Point & delta) {
+    Rect va = area & Rect(self_->size());
+    if (!mapped_ || !va || (0 == delta.x() && 0 == delta.y())) { return false; }
+    if (std::abs(delta.x()) >= va.iwidth() || std::abs(delta.y()) >= va.iheight()) { return false; }
+    bool dbuf = self_->double_buffer_enabled();
+    if (dbuf && XCB_NONE == back_) { return false; }
+
+    Rect src = va & va.translated(-delta), dst = src.translated(delta);
+    Region moved(damage_);
+    moved.intersect(src);
+    moved.translate(delta);
+    damage_.unite(moved);
+
+    if (dbuf) {
+        xcb_copy_area(cx_, back_, back_, back_gc_->xid(), src.x(), src.y(), dst.x(), dst.y(), src.width(), src.height());
+        blits_.unite(dst);
+    }
+
+    else {
+        if (!scroll_gc_) {
+            scroll_gc_ = new Context_xcb(cx_, wid_);
+            scroll_gc_->set_graphics_exposures(true);
+            scroll_gc_->flush();
         }
 
-        invals_.front() |= r;
-    start:
-        paint_timer_.start(33);
+        xcb_copy_area(cx_, wid_, wid_, scroll_gc_->xid(), src.x(), src.y(), dst.x(), dst.y(), src.width(), src.height());
     }
+
+    Region exposed(va);
+    exposed.subtract(dst);
+    for (const Region::Box & b: exposed) { invalidate(Region::to_rect(b)); }
+    return true;
 }
 
+// Paints the damaged region in a single pass: the painter clipped to
+// the region and containers skip children outside of it.
 void Winface_xcb::update() {
     paint_timer_.stop();
 
     if (self_->visible()) {
         if (!pr_) { pr_ = std::make_shared<Painter_xcb>(this); pr_->reserve_stack(16); }
+        bool dbuf = self_->double_buffer_enabled();
         pr_->capture(self_);
+        pr_->begin_frame();
         Painter pr(self_->wrap_painter(pr_));
 
-        for (Rect inval: invals_) {
-            if (!inval) { break; }
+        if (dbuf) {
+            alloc_back(self_->size());
+            pr_->set_target(back_, back_picture_);
+        }
+
+        else {
+            drop_back();
+        }
+
+        // Widgets may invalidate while painting, that goes to the next frame.
+        Region damage(std::move(damage_));
+        uint64_t requested = requested_;
+        damage_.clear();
+        requested_ = 0;
+        damage.intersect(Rect(self_->size()));
+        Rect inval = damage.bounds();
+
+        Paint_profiler * prof = self_->paint_profiler();
+        pr_->set_profiler(prof);
+        if (prof) { prof->begin_frame(); }
+
+        if (inval) {
+            pr_->set_damage(damage);
             pr_->set_obscured_area(inval);
+            pr_->profile_enter(self_, true);
             self_->handle_backpaint(pr, inval);
+            pr_->profile_leave();
+            pr_->profile_enter(self_, false);
             self_->handle_paint(pr, inval);
+            pr_->profile_leave();
+            pr_->reset_damage();
         }
 
         pr_->wreset();
-        invals_.fill(Rect());
+        unsigned ncopies = 0;
+
+        if (dbuf) {
+            pr_->set_target(wid_, xpicture());
+
+            Region copy(damage);
+            copy.unite(blits_);
+            copy.intersect(Rect(self_->size()));
+
+            for (const Region::Box & b: copy) {
+                xcb_copy_area(cx_, back_, wid_, back_gc_->xid(), b.x1, b.y1, b.x1, b.y1, b.x2-b.x1, b.y2-b.y1);
+                ++ncopies;
+            }
+        }
+
+        blits_.clear();
+        stats_ = pr_->end_frame();
+        stats_.requests += ncopies;
+        stats_.requested_px = requested;
+        stats_.damaged_px = damage.area();
+        stats_.bounds_px = uint64_t(inval.width())*inval.height();
+        stats_.damage_rects = damage.size();
+
+        if (prof) {
+            pr_->set_profiler(nullptr);
+            prof->end_frame(ncopies);
+            prof->dump_env(self_);
+        }
+
+        static const bool dump_stats = !str_env("TAU_XCB_STATS").empty();
+
+        if (dump_stats) {
+            std::cerr << "-- Winface_xcb: frame: " << stats_.requests << " requests, " << stats_.flushes << " flushes, "
+                      << stats_.gc_changes << " GC changes, " << stats_.gc_skipped << " GC changes skipped, "
+                      << stats_.rects << " rectangles in " << stats_.batches << " batches, "
+                      << stats_.damaged_px << " pixels repainted in " << stats_.damage_rects << " rectangles, "
+                      << stats_.requested_px << " pixels invalidated, " << stats_.bounds_px << " pixels in bounds" << std::endl;
+        }
     }
 }
 
+// private
+// Back buffer reused between frames, reallocated when window size changes.
+void Winface_xcb::alloc_back(const Size & size) {
+    if (size != back_size_) { drop_back(); }
+
+    if (XCB_NONE == back_ && size) {
+        back_ = xcb_generate_id(cx_);
+        xcb_create_pixmap(cx_, dp_->depth(), back_, wid_, size.width(), size.height());
+        back_gc_ = new Context_xcb(cx_, back_);
+        back_gc_->set_graphics_exposures(false);
+        back_gc_->flush();
+        back_picture_ = xcb_generate_id(cx_);
+        const uint32_t v[1] = { 0 };
+        xcb_render_create_picture(cx_, back_picture_, back_, dp_->pictformat(), 1, v);
+        back_size_ = size;
+        damage_.unite(Rect(size));
+    }
+}
+
+// private
+void Winface_xcb::drop_back() {
+    if (XCB_NONE != back_picture_) { xcb_render_free_picture(cx_, back_picture_); back_picture_ = XCB_NONE; }
+    if (back_gc_) { delete back_gc_; back_gc_ = nullptr; }
+    if (XCB_NONE != back_) { xcb_free_pixmap(cx_, back_); back_ = XCB_NONE; }
+    back_size_.reset();
+}
+
 void Winface_xcb::handle_expose(xcb_expose_event_t * event) {
     invalidate(Rect(event->x, event->y, Size(1+event->width, 1+event->height)));
     update();
 }
 
+void Winface_xcb::handle_graphics_expose(xcb_graphics_exposure_event_t * event) {
+    invalidate(Rect(event->x, event->y, Size(event->width, event->height)));
+}
+
 void Winface_xcb::on_show() {
     xcb_map_window(cx_, wid_);
     xcb_flush(cx_);
@@ -267,6 +402,7 @@ void Winface_xcb::handle_unmap(xcb_unmap_notify_event_t * event) {
 void Winface_xcb::handle_configure(xcb_configure_notify_event_t * event) {
     Size size(event->width, event->height);
     Point pt(event->x, event->y);
+    if (XCB_NONE != back_ && size != back_size_) { drop_back(); }
     self_->update_size(size);
 
     if (XCB_NONE != sync_counter_) {
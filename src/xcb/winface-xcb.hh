@@ -29,7 +29,7 @@
 
 #include <window-impl.hh>
 #include "display-xcb.hh"
-#include <array>
+#include <region-impl.hh>
 
 namespace tau {
 
@@ -55,6 +55,7 @@ public:
     void grab_mouse();
 
     void handle_expose(xcb_expose_event_t * event);
+    void handle_graphics_expose(xcb_graphics_exposure_event_t * event);
     void handle_map(xcb_map_notify_event_t * event);
     void handle_unmap(xcb_unmap_notify_event_t * event);
     void handle_configure(xcb_configure_notify_event_t * event);
@@ -73,9 +74,15 @@ public:
     // Overrides pure Winface.
     void invalidate(const Rect & inval) override;
 
+    // Overrides pure Winface.
+    bool scroll(const Rect & area, const Point & delta) override;
+
     // Overrides pure Winface.
     void update() override;
 
+    // Statistics of the last frame painted by update().
+    const Xcb_counters & stats() const { return stats_; }
+
     // Overrides pure Winface.
     void move(const Point & pt) override;
 
@@ -148,6 +155,8 @@ private:
     void on_show();
     void on_hide();
     void on_hints();
+    void alloc_back(const Size & size);
+    void drop_back();
 
     Display_xcb_ptr     dp_;
     Window_impl *       self_ = nullptr;
@@ -170,8 +179,18 @@ private:
     xcb_sync_counter_t  sync_counter_ = XCB_NONE;
     xcb_sync_int64_t    sync_value_ { 0, 0 };
     Timer               paint_timer_ { fun(this, &Winface_xcb::update) };
-    std::array<Rect, 8> invals_;
+    Region              damage_;        // Pending damage, painted by update().
+    Region              blits_;         // Scrolled within back buffer, copied to window by update().
+    Context_xcb *       scroll_gc_ = nullptr; // Has graphics exposures on.
+    uint64_t            requested_ = 0; // Sum of invalidated areas, overlaps included.
     Painter_xcb_ptr     pr_;
+    Xcb_counters        stats_;
+
+    // Back buffer used for double buffered repaint, see Window_impl::double_buffer_enabled().
+    xcb_pixmap_t        back_ = XCB_NONE;
+    xcb_render_picture_t back_picture_ = XCB_NONE;
+    Context_xcb *       back_gc_ = nullptr;
+    Size                back_size_;
     Point               upos_;  // User requested position.
     Size                usize_; // User requested size.
     std::vector<xcb_atom_t> allowed_actions_;
@@ -27,7 +27,7 @@
 
 PREFIX='/usr/local'
 link='ln -vsf'
-pkg_required+='libpng xkbcommon-x11 xcb xcb-cursor xcb-icccm xcb-renderutil xcb-screensaver xcb-sync xcb-xfixes'
+pkg_required+='libpng xkbcommon-x11 xcb xcb-cursor xcb-icccm xcb-renderutil xcb-screensaver xcb-shm xcb-sync xcb-xfixes'
 headers_required+='inotify.h'
 libdata='lib'
 